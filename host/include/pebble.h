@@ -0,0 +1,237 @@
+/**
+ * Stand-in pebble.h for the headless host build of PGE.
+ *
+ * Declares the subset of the Pebble SDK 3 API used by the engine, implemented by the host runtime:
+ * a software GBitmap and GContext rendering into a 144x168 8-bit frame buffer, resources read from
+ * the files listed in appinfo.json and a virtual clock driving timers at unlimited speed.
+ * Builds as basalt (PBL_PLATFORM_BASALT, PBL_COLOR, PBL_SDK_3 are set by host/Makefile).
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "resource_ids.auto.h"
+
+/********************************** Geometry **********************************/
+
+typedef struct GPoint {
+  int16_t x;
+  int16_t y;
+} GPoint;
+
+typedef struct GSize {
+  int16_t w;
+  int16_t h;
+} GSize;
+
+typedef struct GRect {
+  GPoint origin;
+  GSize size;
+} GRect;
+
+#define GPoint(x, y) ((GPoint){(x), (y)})
+#define GPointZero GPoint(0, 0)
+#define GSize(w, h) ((GSize){(w), (h)})
+#define GSizeZero GSize(0, 0)
+#define GRect(x, y, w, h) ((GRect){{(x), (y)}, {(w), (h)}})
+#define GRectZero GRect(0, 0, 0, 0)
+
+bool gpoint_equal(const GPoint * const point_a, const GPoint * const point_b);
+bool grect_equal(const GRect * const rect_a, const GRect * const rect_b);
+void grect_clip(GRect * const rect_to_clip, const GRect * const rect_clipper);
+bool grect_contains_point(const GRect *rect, const GPoint *point);
+
+/*********************************** Colors ***********************************/
+
+typedef union GColor8 {
+  uint8_t argb;
+  struct {
+    uint8_t b:2;
+    uint8_t g:2;
+    uint8_t r:2;
+    uint8_t a:2;
+  };
+} GColor8;
+
+typedef GColor8 GColor;
+
+#define GColorFromRGBA(red, green, blue, alpha) \
+  ((GColor8){ .a = (uint8_t)(alpha) >> 6, .r = (uint8_t)(red) >> 6, .g = (uint8_t)(green) >> 6, .b = (uint8_t)(blue) >> 6 })
+#define GColorFromRGB(red, green, blue) GColorFromRGBA(red, green, blue, 255)
+#define GColorFromHEX(v) GColorFromRGB(((v) >> 16) & 0xff, ((v) >> 8) & 0xff, ((v) & 0xff))
+
+#define GColorClear ((GColor8){ .argb = 0x00 })
+#define GColorBlack ((GColor8){ .argb = 0xC0 })
+#define GColorWhite ((GColor8){ .argb = 0xFF })
+#define GColorRed ((GColor8){ .argb = 0xF0 })
+#define GColorGreen ((GColor8){ .argb = 0xCC })
+#define GColorBlue ((GColor8){ .argb = 0xC3 })
+#define GColorYellow ((GColor8){ .argb = 0xFC })
+#define GColorLightGray ((GColor8){ .argb = 0xEA })
+#define GColorDarkGray ((GColor8){ .argb = 0xD5 })
+#define GColorVividCerulean ((GColor8){ .argb = 0xDB })
+
+bool gcolor_equal(GColor8 x, GColor8 y);
+
+/********************************** Bitmaps ***********************************/
+
+typedef enum GBitmapFormat {
+  GBitmapFormat1Bit = 0,
+  GBitmapFormat8Bit,
+  GBitmapFormat1BitPalette,
+  GBitmapFormat2BitPalette,
+  GBitmapFormat4BitPalette
+} GBitmapFormat;
+
+// Fields are private to the host runtime, use the gbitmap_* accessors
+typedef struct GBitmap {
+  uint8_t *addr;            // Pixel data, shared with the parent for sub bitmaps
+  uint16_t row_size_bytes;
+  GBitmapFormat format;
+  GRect bounds;             // Area of the data covered by the bitmap
+  GColor *palette;
+  bool owns_data;
+  bool owns_palette;
+} GBitmap;
+
+GBitmap* gbitmap_create_with_resource(uint32_t resource_id);
+GBitmap* gbitmap_create_from_png_data(const uint8_t *png_data, size_t png_data_size);
+GBitmap* gbitmap_create_as_sub_bitmap(const GBitmap *base_bitmap, GRect sub_rect);
+GBitmap* gbitmap_create_blank(GSize size, GBitmapFormat format);
+GBitmap* gbitmap_create_blank_with_palette(GSize size, GBitmapFormat format, GColor *palette, bool free_on_destroy);
+void gbitmap_destroy(GBitmap *bitmap);
+GRect gbitmap_get_bounds(const GBitmap *bitmap);
+void gbitmap_set_bounds(GBitmap *bitmap, GRect bounds);
+uint16_t gbitmap_get_bytes_per_row(const GBitmap *bitmap);
+GBitmapFormat gbitmap_get_format(const GBitmap *bitmap);
+uint8_t* gbitmap_get_data(const GBitmap *bitmap);
+void gbitmap_set_data(GBitmap *bitmap, uint8_t *data, GBitmapFormat format, uint16_t row_size_bytes, bool free_on_destroy);
+GColor* gbitmap_get_palette(const GBitmap *bitmap);
+void gbitmap_set_palette(GBitmap *bitmap, GColor *palette, bool free_on_destroy);
+
+/********************************** Graphics **********************************/
+
+typedef enum GCompOp {
+  GCompOpAssign = 0,
+  GCompOpAssignInverted,
+  GCompOpOr,
+  GCompOpAnd,
+  GCompOpClear,
+  GCompOpSet
+} GCompOp;
+
+typedef enum GCornerMask {
+  GCornerNone = 0,
+  GCornersAll = 0xF
+} GCornerMask;
+
+typedef struct GContext GContext;
+
+void graphics_context_set_compositing_mode(GContext *ctx, GCompOp mode);
+void graphics_context_set_fill_color(GContext *ctx, GColor color);
+void graphics_context_set_stroke_color(GContext *ctx, GColor color);
+void graphics_draw_bitmap_in_rect(GContext *ctx, const GBitmap *bitmap, GRect rect);
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius, GCornerMask corner_mask);
+void graphics_draw_pixel(GContext *ctx, GPoint point);
+void graphics_draw_line(GContext *ctx, GPoint p0, GPoint p1);
+GBitmap* graphics_capture_frame_buffer(GContext *ctx);
+bool graphics_release_frame_buffer(GContext *ctx, GBitmap *buffer);
+
+/********************************* Resources **********************************/
+
+typedef const void* ResHandle;
+
+ResHandle resource_get_handle(uint32_t resource_id);
+size_t resource_size(ResHandle h);
+size_t resource_load(ResHandle h, uint8_t *buffer, size_t max_length);
+size_t resource_load_byte_range(ResHandle h, uint32_t start_offset, uint8_t *buffer, size_t num_bytes);
+
+/******************************** Timers & Time *******************************/
+
+typedef struct AppTimer AppTimer;
+typedef void (*AppTimerCallback)(void *data);
+
+AppTimer* app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void *callback_data);
+bool app_timer_reschedule(AppTimer *timer_handle, uint32_t new_timeout_ms);
+void app_timer_cancel(AppTimer *timer_handle);
+
+// Time of the virtual clock, which only moves forward when the event loop runs the next timer
+uint16_t time_ms(time_t *tloc, uint16_t *out_ms);
+
+/****************************** Windows & Layers ******************************/
+
+typedef struct Layer Layer;
+typedef struct Window Window;
+typedef struct BitmapLayer BitmapLayer;
+
+typedef void (*LayerUpdateProc)(Layer *layer, GContext *ctx);
+typedef void (*WindowHandler)(Window *window);
+
+typedef struct WindowHandlers {
+  WindowHandler load;
+  WindowHandler appear;
+  WindowHandler disappear;
+  WindowHandler unload;
+} WindowHandlers;
+
+Layer* layer_create(GRect frame);
+void layer_destroy(Layer *layer);
+GRect layer_get_frame(const Layer *layer);
+GRect layer_get_bounds(const Layer *layer);
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc);
+void layer_add_child(Layer *parent, Layer *child);
+void layer_mark_dirty(Layer *layer);
+
+BitmapLayer* bitmap_layer_create(GRect frame);
+void bitmap_layer_destroy(BitmapLayer *bitmap_layer);
+Layer* bitmap_layer_get_layer(const BitmapLayer *bitmap_layer);
+void bitmap_layer_set_bitmap(BitmapLayer *bitmap_layer, const GBitmap *bitmap);
+
+Window* window_create(void);
+void window_destroy(Window *window);
+void window_set_background_color(Window *window, GColor background_color);
+void window_set_window_handlers(Window *window, WindowHandlers handlers);
+Layer* window_get_root_layer(const Window *window);
+void window_stack_push(Window *window, bool animated);
+
+/*********************************** Clicks ***********************************/
+
+typedef enum {
+  BUTTON_ID_BACK = 0,
+  BUTTON_ID_UP,
+  BUTTON_ID_SELECT,
+  BUTTON_ID_DOWN,
+  NUM_BUTTONS
+} ButtonId;
+
+typedef void *ClickRecognizerRef;
+typedef void (*ClickHandler)(ClickRecognizerRef recognizer, void *context);
+typedef void (*ClickConfigProvider)(void *context);
+
+void window_set_click_config_provider(Window *window, ClickConfigProvider click_config_provider);
+void window_single_click_subscribe(ButtonId button_id, ClickHandler handler);
+void window_long_click_subscribe(ButtonId button_id, uint16_t delay_ms, ClickHandler down_handler, ClickHandler up_handler);
+void window_raw_click_subscribe(ButtonId button_id, ClickHandler down_handler, ClickHandler up_handler, void *context);
+
+/*********************************** App **************************************/
+
+typedef enum {
+  APP_LOG_LEVEL_ERROR = 1,
+  APP_LOG_LEVEL_WARNING = 50,
+  APP_LOG_LEVEL_INFO = 100,
+  APP_LOG_LEVEL_DEBUG = 200,
+  APP_LOG_LEVEL_DEBUG_VERBOSE = 255
+} AppLogLevel;
+
+// %ld and %lu take 32-bit values like on the watch, where long is 32-bit
+void app_log(uint8_t log_level, const char *src_filename, int src_line_number, const char *fmt, ...);
+
+#define APP_LOG(level, fmt, args...) app_log(level, __FILE__, __LINE__, fmt, ## args)
+
+// Runs timers and renders dirty windows until the virtual run time set with PGE_HOST_RUN_MS is over
+void app_event_loop(void);
@@ -0,0 +1,606 @@
+/**
+ * Windows, layers, clicks, timers and the event loop of the host build.
+ *
+ * Time is virtual: app_event_loop() jumps the clock straight to the next timer or scripted click
+ * instead of sleeping, so the app runs as fast as the host can render it. The window stack holds
+ * a single window, the one pushed last.
+ *
+ * Environment variables:
+ *   PGE_HOST_RUN_MS      Virtual time to run for before returning from app_event_loop(), 10000 by default
+ *   PGE_HOST_CLICKS      Scripted button presses, e.g. "500:select,2000:up:long" (time in ms:button[:long])
+ *   PGE_HOST_SCREENSHOT  Path of a PPM file the last rendered frame is written to
+ */
+#include "pebble_host.h"
+
+#include <stdarg.h>
+
+#define PGE_HOST_EPOCH_MS 1420070400000ULL  // Virtual clock start, 2015-01-01
+#define PGE_HOST_DEFAULT_RUN_MS 10000
+#define PGE_HOST_CLICK_HOLD_MS 100          // Time a scripted button is held down, after the long click delay for long clicks
+#define PGE_HOST_DEFAULT_LONG_CLICK_MS 500
+
+struct Layer {
+  GRect frame;
+  LayerUpdateProc update_proc;
+  Layer *parent;
+  Layer *first_child;
+  Layer *next_sibling;
+};
+
+struct BitmapLayer {
+  Layer layer;                // First so the Layer can be cast back
+  const GBitmap *bitmap;
+};
+
+struct Window {
+  Layer *root_layer;
+  GColor background_color;
+  WindowHandlers handlers;
+  ClickConfigProvider click_config_provider;
+  bool loaded;
+};
+
+struct AppTimer {
+  uint64_t due_ms;
+  uint64_t serial;            // Registration order, timers due at the same time fire in that order
+  AppTimerCallback callback;
+  void *data;
+  AppTimer *next;
+};
+
+typedef struct {
+  ClickHandler single_handler;
+  ClickHandler long_down_handler;
+  ClickHandler long_up_handler;
+  uint16_t long_delay_ms;
+  ClickHandler raw_down_handler;
+  ClickHandler raw_up_handler;
+  void *raw_context;
+} HostClickConfig;
+
+typedef enum {
+  HostClickDown = 0,
+  HostClickLong,
+  HostClickUp,
+  HostClickUpAfterLong
+} HostClickType;
+
+typedef struct {
+  uint64_t time_ms;
+  ButtonId button;
+  HostClickType type;
+} HostClickEvent;
+
+static uint64_t s_now_ms = PGE_HOST_EPOCH_MS;
+
+static AppTimer *s_timers;
+static uint64_t s_timer_serial;
+
+static Window *s_top_window;
+static bool s_render_requested;
+
+static HostClickConfig s_click_configs[NUM_BUTTONS];
+static HostClickEvent *s_click_events;
+static uint32_t s_num_click_events;
+static uint32_t s_next_click_event;
+
+/*********************************** Layers ***********************************/
+
+Layer* layer_create(GRect frame) {
+  Layer *layer = calloc(1, sizeof(Layer));
+  if (layer) {
+    layer->frame = frame;
+  }
+  return layer;
+}
+
+static void prv_layer_remove_from_parent(Layer *layer) {
+  if (!layer->parent) {
+    return;
+  }
+
+  Layer **link = &layer->parent->first_child;
+  while (*link && (*link != layer)) {
+    link = &(*link)->next_sibling;
+  }
+  if (*link) {
+    *link = layer->next_sibling;
+  }
+  layer->parent = NULL;
+  layer->next_sibling = NULL;
+}
+
+static void prv_layer_deinit(Layer *layer) {
+  prv_layer_remove_from_parent(layer);
+  for (Layer *child = layer->first_child; child; ) {
+    Layer *next = child->next_sibling;
+    child->parent = NULL;
+    child->next_sibling = NULL;
+    child = next;
+  }
+}
+
+void layer_destroy(Layer *layer) {
+  if (!layer) {
+    return;
+  }
+
+  prv_layer_deinit(layer);
+  free(layer);
+}
+
+GRect layer_get_frame(const Layer *layer) {
+  return (layer) ? layer->frame : GRectZero;
+}
+
+GRect layer_get_bounds(const Layer *layer) {
+  return (layer) ? GRect(0, 0, layer->frame.size.w, layer->frame.size.h) : GRectZero;
+}
+
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc) {
+  if (layer) {
+    layer->update_proc = update_proc;
+  }
+}
+
+void layer_add_child(Layer *parent, Layer *child) {
+  if ((!parent) || (!child)) {
+    return;
+  }
+
+  // Children are drawn in the order they were added, the last one on top
+  prv_layer_remove_from_parent(child);
+  Layer **link = &parent->first_child;
+  while (*link) {
+    link = &(*link)->next_sibling;
+  }
+  *link = child;
+  child->parent = parent;
+}
+
+void layer_mark_dirty(Layer *layer) {
+  s_render_requested = true;
+}
+
+static void prv_bitmap_layer_update_proc(Layer *layer, GContext *ctx) {
+  BitmapLayer *bitmap_layer = (BitmapLayer*)layer;
+  if (bitmap_layer->bitmap) {
+    graphics_draw_bitmap_in_rect(ctx, bitmap_layer->bitmap, gbitmap_get_bounds(bitmap_layer->bitmap));
+  }
+}
+
+BitmapLayer* bitmap_layer_create(GRect frame) {
+  BitmapLayer *bitmap_layer = calloc(1, sizeof(BitmapLayer));
+  if (bitmap_layer) {
+    bitmap_layer->layer.frame = frame;
+    bitmap_layer->layer.update_proc = prv_bitmap_layer_update_proc;
+  }
+  return bitmap_layer;
+}
+
+void bitmap_layer_destroy(BitmapLayer *bitmap_layer) {
+  if (!bitmap_layer) {
+    return;
+  }
+
+  prv_layer_deinit(&bitmap_layer->layer);
+  free(bitmap_layer);
+}
+
+Layer* bitmap_layer_get_layer(const BitmapLayer *bitmap_layer) {
+  return (bitmap_layer) ? (Layer*)&bitmap_layer->layer : NULL;
+}
+
+void bitmap_layer_set_bitmap(BitmapLayer *bitmap_layer, const GBitmap *bitmap) {
+  if (bitmap_layer) {
+    bitmap_layer->bitmap = bitmap;
+    s_render_requested = true;
+  }
+}
+
+/*********************************** Windows **********************************/
+
+Window* window_create(void) {
+  Window *window = calloc(1, sizeof(Window));
+  if (!window) {
+    return NULL;
+  }
+
+  window->root_layer = layer_create(GRect(0, 0, PGE_HOST_SCREEN_WIDTH, PGE_HOST_SCREEN_HEIGHT));
+  if (!window->root_layer) {
+    free(window);
+    return NULL;
+  }
+  window->background_color = GColorWhite;
+  return window;
+}
+
+void window_destroy(Window *window) {
+  if (!window) {
+    return;
+  }
+
+  // Destroying the window on the stack removes it, like on the watch
+  if (window == s_top_window) {
+    if (window->handlers.disappear) {
+      window->handlers.disappear(window);
+    }
+    s_top_window = NULL;
+  }
+  if (window->loaded && window->handlers.unload) {
+    window->handlers.unload(window);
+  }
+  layer_destroy(window->root_layer);
+  free(window);
+}
+
+void window_set_background_color(Window *window, GColor background_color) {
+  if (window) {
+    window->background_color = background_color;
+  }
+}
+
+void window_set_window_handlers(Window *window, WindowHandlers handlers) {
+  if (window) {
+    window->handlers = handlers;
+  }
+}
+
+Layer* window_get_root_layer(const Window *window) {
+  return (window) ? window->root_layer : NULL;
+}
+
+void window_stack_push(Window *window, bool animated) {
+  if ((!window) || (window == s_top_window)) {
+    return;
+  }
+
+  if (s_top_window && s_top_window->handlers.disappear) {
+    s_top_window->handlers.disappear(s_top_window);
+  }
+  s_top_window = window;
+
+  memset(s_click_configs, 0, sizeof(s_click_configs));
+  if (window->click_config_provider) {
+    window->click_config_provider(window);
+  }
+  if (!window->loaded) {
+    window->loaded = true;
+    if (window->handlers.load) {
+      window->handlers.load(window);
+    }
+  }
+  if (window->handlers.appear) {
+    window->handlers.appear(window);
+  }
+  s_render_requested = true;
+}
+
+/*********************************** Clicks ***********************************/
+
+void window_set_click_config_provider(Window *window, ClickConfigProvider click_config_provider) {
+  if (window) {
+    window->click_config_provider = click_config_provider;
+  }
+}
+
+void window_single_click_subscribe(ButtonId button_id, ClickHandler handler) {
+  if (button_id < NUM_BUTTONS) {
+    s_click_configs[button_id].single_handler = handler;
+  }
+}
+
+void window_long_click_subscribe(ButtonId button_id, uint16_t delay_ms, ClickHandler down_handler, ClickHandler up_handler) {
+  if (button_id < NUM_BUTTONS) {
+    s_click_configs[button_id].long_delay_ms = (delay_ms > 0) ? delay_ms : PGE_HOST_DEFAULT_LONG_CLICK_MS;
+    s_click_configs[button_id].long_down_handler = down_handler;
+    s_click_configs[button_id].long_up_handler = up_handler;
+  }
+}
+
+void window_raw_click_subscribe(ButtonId button_id, ClickHandler down_handler, ClickHandler up_handler, void *context) {
+  if (button_id < NUM_BUTTONS) {
+    s_click_configs[button_id].raw_down_handler = down_handler;
+    s_click_configs[button_id].raw_up_handler = up_handler;
+    s_click_configs[button_id].raw_context = context;
+  }
+}
+
+static void prv_call(ClickHandler handler, ButtonId button, void *context) {
+  if (handler) {
+    handler((ClickRecognizerRef)&s_click_configs[button], context);
+  }
+}
+
+static void prv_dispatch_click_event(const HostClickEvent *event) {
+  HostClickConfig *config = &s_click_configs[event->button];
+  switch (event->type) {
+    case HostClickDown:
+      prv_call(config->raw_down_handler, event->button, config->raw_context);
+      break;
+    case HostClickLong:
+      prv_call(config->long_down_handler, event->button, s_top_window);
+      break;
+    case HostClickUp:
+      prv_call(config->raw_up_handler, event->button, config->raw_context);
+      prv_call(config->single_handler, event->button, s_top_window);
+      break;
+    case HostClickUpAfterLong:
+      prv_call(config->raw_up_handler, event->button, config->raw_context);
+      prv_call(config->long_up_handler, event->button, s_top_window);
+      break;
+  }
+}
+
+static bool prv_parse_button(const char *name, ButtonId *button) {
+  static const char *s_names[NUM_BUTTONS] = { "back", "up", "select", "down" };
+  for (int i = 0; i < NUM_BUTTONS; i++) {
+    if (strcmp(name, s_names[i]) == 0) {
+      *button = (ButtonId)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void prv_add_click_event(uint64_t time_ms, ButtonId button, HostClickType type) {
+  // Keep the events sorted by time, events at the same time stay in the order they were added
+  uint32_t i = s_num_click_events++;
+  while ((i > 0) && (s_click_events[i - 1].time_ms > time_ms)) {
+    s_click_events[i] = s_click_events[i - 1];
+    i--;
+  }
+  s_click_events[i] = (HostClickEvent) { .time_ms = time_ms, .button = button, .type = type };
+}
+
+// Turn the presses of PGE_HOST_CLICKS into down, long and up events
+static void prv_load_click_script(void) {
+  const char *script = getenv("PGE_HOST_CLICKS");
+  if (!script || !*script) {
+    return;
+  }
+
+  uint32_t max_presses = 1;
+  for (const char *c = script; *c; c++) {
+    max_presses += (*c == ',') ? 1 : 0;
+  }
+  s_click_events = calloc(max_presses * 3, sizeof(HostClickEvent));
+  char *copy = strdup(script);
+  if (!s_click_events || !copy) {
+    free(copy);
+    return;
+  }
+
+  char *press_save;
+  for (char *press = strtok_r(copy, ",", &press_save); press; press = strtok_r(NULL, ",", &press_save)) {
+    char *field_save;
+    char *time_field = strtok_r(press, ":", &field_save);
+    char *button_field = strtok_r(NULL, ":", &field_save);
+    char *long_field = strtok_r(NULL, ":", &field_save);
+    ButtonId button;
+    if (!time_field || !button_field || !prv_parse_button(button_field, &button) ||
+        (long_field && (strcmp(long_field, "long") != 0))) {
+      APP_LOG(APP_LOG_LEVEL_WARNING, "Ignoring click '%s', expected <ms>:<back|up|select|down>[:long]", press);
+      continue;
+    }
+
+    uint64_t down_ms = s_now_ms + strtoull(time_field, NULL, 10);
+    prv_add_click_event(down_ms, button, HostClickDown);
+    if (long_field) {
+      // The long click delay is only known once the window subscribed, use the default otherwise
+      uint16_t delay_ms = s_click_configs[button].long_delay_ms;
+      delay_ms = (delay_ms > 0) ? delay_ms : PGE_HOST_DEFAULT_LONG_CLICK_MS;
+      prv_add_click_event(down_ms + delay_ms, button, HostClickLong);
+      prv_add_click_event(down_ms + delay_ms + PGE_HOST_CLICK_HOLD_MS, button, HostClickUpAfterLong);
+    } else {
+      prv_add_click_event(down_ms + PGE_HOST_CLICK_HOLD_MS, button, HostClickUp);
+    }
+  }
+  free(copy);
+}
+
+/******************************** Timers & Time *******************************/
+
+uint16_t time_ms(time_t *tloc, uint16_t *out_ms) {
+  uint16_t ms = s_now_ms % 1000;
+  if (tloc) {
+    *tloc = (time_t)(s_now_ms / 1000);
+  }
+  if (out_ms) {
+    *out_ms = ms;
+  }
+  return ms;
+}
+
+static void prv_insert_timer(AppTimer *timer) {
+  AppTimer **link = &s_timers;
+  while (*link && (((*link)->due_ms < timer->due_ms) ||
+                   (((*link)->due_ms == timer->due_ms) && ((*link)->serial < timer->serial)))) {
+    link = &(*link)->next;
+  }
+  timer->next = *link;
+  *link = timer;
+}
+
+static bool prv_remove_timer(AppTimer *timer) {
+  AppTimer **link = &s_timers;
+  while (*link && (*link != timer)) {
+    link = &(*link)->next;
+  }
+  if (!*link) {
+    return false;
+  }
+  *link = timer->next;
+  return true;
+}
+
+AppTimer* app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void *callback_data) {
+  AppTimer *timer = calloc(1, sizeof(AppTimer));
+  if (!timer) {
+    return NULL;
+  }
+
+  timer->due_ms = s_now_ms + timeout_ms;
+  timer->serial = s_timer_serial++;
+  timer->callback = callback;
+  timer->data = callback_data;
+  prv_insert_timer(timer);
+  return timer;
+}
+
+bool app_timer_reschedule(AppTimer *timer_handle, uint32_t new_timeout_ms) {
+  if (!timer_handle || !prv_remove_timer(timer_handle)) {
+    return false;
+  }
+
+  timer_handle->due_ms = s_now_ms + new_timeout_ms;
+  timer_handle->serial = s_timer_serial++;
+  prv_insert_timer(timer_handle);
+  return true;
+}
+
+void app_timer_cancel(AppTimer *timer_handle) {
+  // Handles of timers that already fired are invalid, the same as on the watch
+  if (timer_handle && prv_remove_timer(timer_handle)) {
+    free(timer_handle);
+  }
+}
+
+/*********************************** App **************************************/
+
+void app_log(uint8_t log_level, const char *src_filename, int src_line_number, const char *fmt, ...) {
+  const char *level = (log_level <= APP_LOG_LEVEL_ERROR) ? "E" :
+                      (log_level <= APP_LOG_LEVEL_WARNING) ? "W" :
+                      (log_level <= APP_LOG_LEVEL_INFO) ? "I" : "D";
+  const char *file = strrchr(src_filename, '/');
+  file = (file) ? file + 1 : src_filename;
+
+  // Apps log 32-bit integers with %ld as long is 32-bit on the watch, drop the l for the host's 64-bit long
+  char host_fmt[256];
+  size_t length = 0;
+  for (const char *c = fmt; *c && (length < sizeof(host_fmt) - 1); c++) {
+    host_fmt[length++] = *c;
+    if (*c != '%') {
+      continue;
+    }
+    if ((c[1] == '%') && (length < sizeof(host_fmt) - 1)) {
+      host_fmt[length++] = *++c;
+      continue;
+    }
+    // Copy the flags, width and precision, then skip a single l length modifier
+    while (c[1] && strchr("0123456789.-+ #", c[1]) && (length < sizeof(host_fmt) - 1)) {
+      host_fmt[length++] = *++c;
+    }
+    if ((c[1] == 'l') && (c[2] != 'l')) {
+      c++;
+    }
+  }
+  host_fmt[length] = '\0';
+
+  va_list args;
+  va_start(args, fmt);
+  fprintf(stderr, "[%s] %s:%d> ", level, file, src_line_number);
+  vfprintf(stderr, host_fmt, args);
+  fputc('\n', stderr);
+  va_end(args);
+}
+
+static void prv_render_layer(GContext *ctx, Layer *layer, GPoint origin, GRect clip) {
+  GPoint layer_origin = GPoint(origin.x + layer->frame.origin.x, origin.y + layer->frame.origin.y);
+  GRect layer_clip = GRect(layer_origin.x, layer_origin.y, layer->frame.size.w, layer->frame.size.h);
+  grect_clip(&layer_clip, &clip);
+  if ((layer_clip.size.w == 0) || (layer_clip.size.h == 0)) {
+    return;
+  }
+
+  if (layer->update_proc) {
+    pge_host_context_begin(ctx, layer_origin, layer_clip);
+    layer->update_proc(layer, ctx);
+  }
+  for (Layer *child = layer->first_child; child; child = child->next_sibling) {
+    prv_render_layer(ctx, child, layer_origin, layer_clip);
+  }
+}
+
+static void prv_render(void) {
+  s_render_requested = false;
+  if (!s_top_window) {
+    return;
+  }
+
+  GContext *ctx = pge_host_get_context();
+  GRect screen = GRect(0, 0, PGE_HOST_SCREEN_WIDTH, PGE_HOST_SCREEN_HEIGHT);
+  pge_host_context_begin(ctx, GPointZero, screen);
+  graphics_context_set_fill_color(ctx, s_top_window->background_color);
+  graphics_fill_rect(ctx, screen, 0, GCornerNone);
+  prv_render_layer(ctx, s_top_window->root_layer, GPointZero, screen);
+}
+
+static double prv_wall_ms(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec * 1000.0) + (now.tv_nsec / 1000000.0);
+}
+
+void app_event_loop(void) {
+  const char *run_ms_env = getenv("PGE_HOST_RUN_MS");
+  uint64_t run_ms = (run_ms_env) ? strtoull(run_ms_env, NULL, 10) : PGE_HOST_DEFAULT_RUN_MS;
+  uint64_t start_ms = s_now_ms;
+  uint64_t end_ms = start_ms + run_ms;
+  prv_load_click_script();
+
+  uint32_t num_frames = 0;
+  double render_ms = 0;
+  double max_render_ms = 0;
+  double loop_start_ms = prv_wall_ms();
+  while (true) {
+    if (s_render_requested) {
+      double render_start_ms = prv_wall_ms();
+      prv_render();
+      double frame_ms = prv_wall_ms() - render_start_ms;
+      render_ms += frame_ms;
+      max_render_ms = (frame_ms > max_render_ms) ? frame_ms : max_render_ms;
+      num_frames++;
+    }
+
+    // Jump to whatever comes first, a timer or a scripted click
+    HostClickEvent *click = (s_next_click_event < s_num_click_events) ? &s_click_events[s_next_click_event] : NULL;
+    AppTimer *timer = s_timers;
+    if (click && timer) {
+      if (timer->due_ms <= click->time_ms) {
+        click = NULL;
+      } else {
+        timer = NULL;
+      }
+    }
+    uint64_t next_ms = (click) ? click->time_ms : (timer) ? timer->due_ms : end_ms + 1;
+    if (next_ms > end_ms) {
+      break;
+    }
+    if (next_ms > s_now_ms) {
+      s_now_ms = next_ms;
+    }
+
+    if (click) {
+      s_next_click_event++;
+      prv_dispatch_click_event(click);
+    } else {
+      prv_remove_timer(timer);
+      timer->callback(timer->data);
+      free(timer);
+    }
+  }
+
+  double wall_ms = prv_wall_ms() - loop_start_ms;
+  fprintf(stderr, "host: %u frames in %llu virtual ms, %.1f wall ms (%.0f frames/s), render avg %.3f ms max %.3f ms\n",
+          num_frames, (unsigned long long)(s_now_ms - start_ms), wall_ms,
+          (wall_ms > 0) ? (num_frames * 1000.0 / wall_ms) : 0.0,
+          (num_frames > 0) ? (render_ms / num_frames) : 0.0, max_render_ms);
+
+  const char *screenshot = getenv("PGE_HOST_SCREENSHOT");
+  if (screenshot && !pge_host_write_screenshot(screenshot)) {
+    fprintf(stderr, "host: unable to write %s\n", screenshot);
+  }
+  free(s_click_events);
+  s_click_events = NULL;
+}
@@ -0,0 +1,474 @@
+/**
+ * Software GBitmap and GContext of the host build.
+ *
+ * The frame buffer is a 144x168 GBitmapFormat8Bit bitmap like on basalt. Color sources are drawn
+ * with GCompOpAssign (copy) or GCompOpSet (2-bit alpha blend, transparent pixels skipped), the other
+ * compositing modes only apply to GBitmapFormat1Bit sources, as on the watch.
+ */
+#include <pebble.h>
+#include <png.h>
+
+#include "pebble_host.h"
+
+struct GContext {
+  GBitmap *frame_buffer;
+  GPoint offset;          // Origin of the layer being drawn, in frame buffer pixels
+  GRect clip;             // Drawable area of the layer being drawn, in frame buffer pixels
+  GColor fill_color;
+  GColor stroke_color;
+  GCompOp compositing_mode;
+  bool captured;
+};
+
+static uint8_t s_frame_buffer_data[PGE_HOST_SCREEN_WIDTH * PGE_HOST_SCREEN_HEIGHT];
+static GBitmap s_frame_buffer = {
+  .addr = s_frame_buffer_data,
+  .row_size_bytes = PGE_HOST_SCREEN_WIDTH,
+  .format = GBitmapFormat8Bit,
+  .bounds = {{0, 0}, {PGE_HOST_SCREEN_WIDTH, PGE_HOST_SCREEN_HEIGHT}}
+};
+static GContext s_context = {
+  .frame_buffer = &s_frame_buffer,
+  .clip = {{0, 0}, {PGE_HOST_SCREEN_WIDTH, PGE_HOST_SCREEN_HEIGHT}},
+  .fill_color = {.argb = 0xFF},
+  .stroke_color = {.argb = 0xC0}
+};
+
+/********************************** Geometry **********************************/
+
+bool gpoint_equal(const GPoint * const point_a, const GPoint * const point_b) {
+  return (point_a->x == point_b->x) && (point_a->y == point_b->y);
+}
+
+bool grect_equal(const GRect * const rect_a, const GRect * const rect_b) {
+  return gpoint_equal(&rect_a->origin, &rect_b->origin) &&
+         (rect_a->size.w == rect_b->size.w) && (rect_a->size.h == rect_b->size.h);
+}
+
+void grect_clip(GRect * const rect_to_clip, const GRect * const rect_clipper) {
+  int x0 = (rect_to_clip->origin.x > rect_clipper->origin.x) ? rect_to_clip->origin.x : rect_clipper->origin.x;
+  int y0 = (rect_to_clip->origin.y > rect_clipper->origin.y) ? rect_to_clip->origin.y : rect_clipper->origin.y;
+  int x1 = rect_to_clip->origin.x + rect_to_clip->size.w;
+  int y1 = rect_to_clip->origin.y + rect_to_clip->size.h;
+  if (x1 > rect_clipper->origin.x + rect_clipper->size.w) {
+    x1 = rect_clipper->origin.x + rect_clipper->size.w;
+  }
+  if (y1 > rect_clipper->origin.y + rect_clipper->size.h) {
+    y1 = rect_clipper->origin.y + rect_clipper->size.h;
+  }
+  *rect_to_clip = ((x1 > x0) && (y1 > y0)) ? GRect(x0, y0, x1 - x0, y1 - y0) : GRect(x0, y0, 0, 0);
+}
+
+bool grect_contains_point(const GRect *rect, const GPoint *point) {
+  return (point->x >= rect->origin.x) && (point->x < rect->origin.x + rect->size.w) &&
+         (point->y >= rect->origin.y) && (point->y < rect->origin.y + rect->size.h);
+}
+
+bool gcolor_equal(GColor8 x, GColor8 y) {
+  return x.argb == y.argb;
+}
+
+/********************************** Bitmaps ***********************************/
+
+static uint16_t prv_row_size_bytes(int16_t width, GBitmapFormat format) {
+  switch (format) {
+    case GBitmapFormat1Bit:
+      // Rows of 1-bit bitmaps are word aligned
+      return ((width + 31) / 32) * 4;
+    case GBitmapFormat8Bit:
+      return width;
+    case GBitmapFormat1BitPalette:
+      return (width + 7) / 8;
+    case GBitmapFormat2BitPalette:
+      return (width + 3) / 4;
+    case GBitmapFormat4BitPalette:
+      return (width + 1) / 2;
+    default:
+      return 0;
+  }
+}
+
+static uint8_t prv_get_pixel(const GBitmap *bitmap, int x, int y) {
+  const uint8_t *row = &bitmap->addr[y * bitmap->row_size_bytes];
+  switch (bitmap->format) {
+    case GBitmapFormat8Bit:
+      return row[x];
+    case GBitmapFormat1BitPalette:
+      return bitmap->palette[(row[x >> 3] >> (7 - (x & 7))) & 0x1].argb;
+    case GBitmapFormat2BitPalette:
+      return bitmap->palette[(row[x >> 2] >> (6 - ((x & 3) << 1))) & 0x3].argb;
+    case GBitmapFormat4BitPalette:
+      return bitmap->palette[(row[x >> 1] >> (4 - ((x & 1) << 2))) & 0xF].argb;
+    case GBitmapFormat1Bit:
+      return ((row[x >> 3] >> (x & 7)) & 0x1) ? GColorWhite.argb : GColorBlack.argb;
+    default:
+      return GColorClear.argb;
+  }
+}
+
+GBitmap* gbitmap_create_blank(GSize size, GBitmapFormat format) {
+  uint16_t row_size_bytes = prv_row_size_bytes(size.w, format);
+  if ((size.w <= 0) || (size.h <= 0) || (row_size_bytes == 0)) {
+    return NULL;
+  }
+
+  GBitmap *bitmap = calloc(1, sizeof(GBitmap));
+  if (!bitmap) {
+    return NULL;
+  }
+  bitmap->addr = calloc(size.h, row_size_bytes);
+  if (!bitmap->addr) {
+    free(bitmap);
+    return NULL;
+  }
+  bitmap->row_size_bytes = row_size_bytes;
+  bitmap->format = format;
+  bitmap->bounds = GRect(0, 0, size.w, size.h);
+  bitmap->owns_data = true;
+  return bitmap;
+}
+
+GBitmap* gbitmap_create_blank_with_palette(GSize size, GBitmapFormat format, GColor *palette, bool free_on_destroy) {
+  GBitmap *bitmap = gbitmap_create_blank(size, format);
+  if (bitmap) {
+    gbitmap_set_palette(bitmap, palette, free_on_destroy);
+  }
+  return bitmap;
+}
+
+GBitmap* gbitmap_create_as_sub_bitmap(const GBitmap *base_bitmap, GRect sub_rect) {
+  if (!base_bitmap) {
+    return NULL;
+  }
+
+  GBitmap *bitmap = calloc(1, sizeof(GBitmap));
+  if (!bitmap) {
+    return NULL;
+  }
+
+  // The sub bitmap shares the data and palette of its parent, which has to outlive it
+  grect_clip(&sub_rect, &base_bitmap->bounds);
+  *bitmap = *base_bitmap;
+  bitmap->bounds = sub_rect;
+  bitmap->owns_data = false;
+  bitmap->owns_palette = false;
+  return bitmap;
+}
+
+GBitmap* gbitmap_create_from_png_data(const uint8_t *png_data, size_t png_data_size) {
+  png_image image;
+  memset(&image, 0, sizeof(image));
+  image.version = PNG_IMAGE_VERSION;
+  if (!png_image_begin_read_from_memory(&image, png_data, png_data_size)) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "PNG decode failed: %s", image.message);
+    return NULL;
+  }
+
+  image.format = PNG_FORMAT_RGBA;
+  png_bytep rgba = malloc(PNG_IMAGE_SIZE(image));
+  if (!rgba) {
+    png_image_free(&image);
+    return NULL;
+  }
+  if (!png_image_finish_read(&image, NULL, rgba, 0, NULL)) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "PNG decode failed: %s", image.message);
+    free(rgba);
+    return NULL;
+  }
+
+  // Quantize to 8-bit colors, the way basalt stores decoded PNGs with more than 16 colors
+  GBitmap *bitmap = gbitmap_create_blank(GSize(image.width, image.height), GBitmapFormat8Bit);
+  if (bitmap) {
+    for (uint32_t i = 0; i < image.width * image.height; i++) {
+      png_bytep pixel = &rgba[i * 4];
+      bitmap->addr[i] = GColorFromRGBA(pixel[0], pixel[1], pixel[2], pixel[3]).argb;
+    }
+  }
+  free(rgba);
+  return bitmap;
+}
+
+GBitmap* gbitmap_create_with_resource(uint32_t resource_id) {
+  ResHandle handle = resource_get_handle(resource_id);
+  size_t size = resource_size(handle);
+  if (size == 0) {
+    return NULL;
+  }
+
+  uint8_t *data = malloc(size);
+  if (!data) {
+    return NULL;
+  }
+  GBitmap *bitmap = NULL;
+  if (resource_load(handle, data, size) == size) {
+    bitmap = gbitmap_create_from_png_data(data, size);
+  }
+  free(data);
+  return bitmap;
+}
+
+void gbitmap_destroy(GBitmap *bitmap) {
+  if (!bitmap) {
+    return;
+  }
+
+  if (bitmap->owns_data) {
+    free(bitmap->addr);
+  }
+  if (bitmap->owns_palette) {
+    free(bitmap->palette);
+  }
+  free(bitmap);
+}
+
+GRect gbitmap_get_bounds(const GBitmap *bitmap) {
+  return (bitmap) ? bitmap->bounds : GRectZero;
+}
+
+void gbitmap_set_bounds(GBitmap *bitmap, GRect bounds) {
+  if (bitmap) {
+    bitmap->bounds = bounds;
+  }
+}
+
+uint16_t gbitmap_get_bytes_per_row(const GBitmap *bitmap) {
+  return (bitmap) ? bitmap->row_size_bytes : 0;
+}
+
+GBitmapFormat gbitmap_get_format(const GBitmap *bitmap) {
+  return (bitmap) ? bitmap->format : GBitmapFormat1Bit;
+}
+
+uint8_t* gbitmap_get_data(const GBitmap *bitmap) {
+  return (bitmap) ? bitmap->addr : NULL;
+}
+
+void gbitmap_set_data(GBitmap *bitmap, uint8_t *data, GBitmapFormat format, uint16_t row_size_bytes, bool free_on_destroy) {
+  if (!bitmap) {
+    return;
+  }
+
+  if (bitmap->owns_data && (bitmap->addr != data)) {
+    free(bitmap->addr);
+  }
+  bitmap->addr = data;
+  bitmap->format = format;
+  bitmap->row_size_bytes = row_size_bytes;
+  bitmap->owns_data = free_on_destroy;
+}
+
+GColor* gbitmap_get_palette(const GBitmap *bitmap) {
+  return (bitmap) ? bitmap->palette : NULL;
+}
+
+void gbitmap_set_palette(GBitmap *bitmap, GColor *palette, bool free_on_destroy) {
+  if (!bitmap) {
+    return;
+  }
+
+  if (bitmap->owns_palette && (bitmap->palette != palette)) {
+    free(bitmap->palette);
+  }
+  bitmap->palette = palette;
+  bitmap->owns_palette = free_on_destroy;
+}
+
+/********************************** Graphics **********************************/
+
+GContext* pge_host_get_context(void) {
+  return &s_context;
+}
+
+void pge_host_context_begin(GContext *ctx, GPoint offset, GRect clip) {
+  ctx->offset = offset;
+  ctx->clip = clip;
+  ctx->fill_color = GColorWhite;
+  ctx->stroke_color = GColorBlack;
+  ctx->compositing_mode = GCompOpAssign;
+}
+
+// Blend a color into a frame buffer pixel with its 2-bit alpha, the frame buffer stays opaque
+static void prv_blend(uint8_t *dst, uint8_t src) {
+  GColor8 s = {.argb = src};
+  GColor8 d = {.argb = *dst};
+  if (s.a == 3) {
+    *dst = src;
+  } else if (s.a > 0) {
+    d.r = ((s.r * s.a) + (d.r * (3 - s.a))) / 3;
+    d.g = ((s.g * s.a) + (d.g * (3 - s.a))) / 3;
+    d.b = ((s.b * s.a) + (d.b * (3 - s.a))) / 3;
+    *dst = d.argb | 0xC0;
+  }
+}
+
+// Apply the compositing mode to a pixel of a 1-bit source, white pixels are the set bits
+static void prv_composite_1bit(uint8_t *dst, bool white, GCompOp mode) {
+  switch (mode) {
+    case GCompOpAssign:
+      *dst = white ? GColorWhite.argb : GColorBlack.argb;
+      break;
+    case GCompOpAssignInverted:
+      *dst = white ? GColorBlack.argb : GColorWhite.argb;
+      break;
+    case GCompOpOr:
+      if (white) {
+        *dst = GColorWhite.argb;
+      }
+      break;
+    case GCompOpAnd:
+      if (!white) {
+        *dst = GColorBlack.argb;
+      }
+      break;
+    case GCompOpClear:
+      if (white) {
+        *dst = GColorBlack.argb;
+      }
+      break;
+    case GCompOpSet:
+      if (!white) {
+        *dst = GColorWhite.argb;
+      }
+      break;
+  }
+}
+
+// Convert a rect of the layer being drawn to frame buffer pixels clipped to the layer
+static GRect prv_clip_to_context(GContext *ctx, GRect rect) {
+  rect.origin.x += ctx->offset.x;
+  rect.origin.y += ctx->offset.y;
+  grect_clip(&rect, &ctx->clip);
+  return rect;
+}
+
+static uint8_t* prv_frame_buffer_pixel(GContext *ctx, int x, int y) {
+  return &ctx->frame_buffer->addr[(y * ctx->frame_buffer->row_size_bytes) + x];
+}
+
+void graphics_context_set_compositing_mode(GContext *ctx, GCompOp mode) {
+  ctx->compositing_mode = mode;
+}
+
+void graphics_context_set_fill_color(GContext *ctx, GColor color) {
+  ctx->fill_color = color;
+}
+
+void graphics_context_set_stroke_color(GContext *ctx, GColor color) {
+  ctx->stroke_color = color;
+}
+
+void graphics_draw_bitmap_in_rect(GContext *ctx, const GBitmap *bitmap, GRect rect) {
+  if ((!ctx) || (!bitmap) || (ctx->captured) || (bitmap->bounds.size.w <= 0) || (bitmap->bounds.size.h <= 0)) {
+    return;
+  }
+
+  GRect dst = prv_clip_to_context(ctx, rect);
+  if ((dst.size.w == 0) || (dst.size.h == 0)) {
+    return;
+  }
+
+  // The bitmap is tiled when the rect is larger than it
+  int rect_x = rect.origin.x + ctx->offset.x;
+  int rect_y = rect.origin.y + ctx->offset.y;
+  GRect src = bitmap->bounds;
+  for (int y = dst.origin.y; y < dst.origin.y + dst.size.h; y++) {
+    int src_y = src.origin.y + ((y - rect_y) % src.size.h);
+    uint8_t *dst_pixel = prv_frame_buffer_pixel(ctx, dst.origin.x, y);
+    for (int x = dst.origin.x; x < dst.origin.x + dst.size.w; x++, dst_pixel++) {
+      int src_x = src.origin.x + ((x - rect_x) % src.size.w);
+      uint8_t color = prv_get_pixel(bitmap, src_x, src_y);
+      if (bitmap->format == GBitmapFormat1Bit) {
+        prv_composite_1bit(dst_pixel, color == GColorWhite.argb, ctx->compositing_mode);
+      } else if (ctx->compositing_mode == GCompOpSet) {
+        prv_blend(dst_pixel, color);
+      } else {
+        *dst_pixel = color | 0xC0;
+      }
+    }
+  }
+}
+
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius, GCornerMask corner_mask) {
+  // Rounded corners are not drawn by the host build
+  if ((!ctx) || (ctx->captured)) {
+    return;
+  }
+
+  GRect dst = prv_clip_to_context(ctx, rect);
+  for (int y = dst.origin.y; y < dst.origin.y + dst.size.h; y++) {
+    uint8_t *dst_pixel = prv_frame_buffer_pixel(ctx, dst.origin.x, y);
+    for (int x = 0; x < dst.size.w; x++) {
+      prv_blend(&dst_pixel[x], ctx->fill_color.argb);
+    }
+  }
+}
+
+void graphics_draw_pixel(GContext *ctx, GPoint point) {
+  if ((!ctx) || (ctx->captured)) {
+    return;
+  }
+
+  point.x += ctx->offset.x;
+  point.y += ctx->offset.y;
+  if (grect_contains_point(&ctx->clip, &point)) {
+    prv_blend(prv_frame_buffer_pixel(ctx, point.x, point.y), ctx->stroke_color.argb);
+  }
+}
+
+void graphics_draw_line(GContext *ctx, GPoint p0, GPoint p1) {
+  int dx = abs(p1.x - p0.x);
+  int dy = -abs(p1.y - p0.y);
+  int sx = (p0.x < p1.x) ? 1 : -1;
+  int sy = (p0.y < p1.y) ? 1 : -1;
+  int err = dx + dy;
+  while (true) {
+    graphics_draw_pixel(ctx, p0);
+    if ((p0.x == p1.x) && (p0.y == p1.y)) {
+      break;
+    }
+    int e2 = 2 * err;
+    if (e2 >= dy) {
+      err += dy;
+      p0.x += sx;
+    }
+    if (e2 <= dx) {
+      err += dx;
+      p0.y += sy;
+    }
+  }
+}
+
+GBitmap* graphics_capture_frame_buffer(GContext *ctx) {
+  if ((!ctx) || (ctx->captured)) {
+    return NULL;
+  }
+
+  // Drawing calls are ignored until the frame buffer is released, as on the watch
+  ctx->captured = true;
+  return ctx->frame_buffer;
+}
+
+bool graphics_release_frame_buffer(GContext *ctx, GBitmap *buffer) {
+  if ((!ctx) || (!ctx->captured) || (buffer != ctx->frame_buffer)) {
+    return false;
+  }
+
+  ctx->captured = false;
+  return true;
+}
+
+bool pge_host_write_screenshot(const char *path) {
+  FILE *file = fopen(path, "wb");
+  if (!file) {
+    return false;
+  }
+
+  // Binary PPM, each 2-bit channel scaled to 8 bits
+  fprintf(file, "P6\n%d %d\n255\n", PGE_HOST_SCREEN_WIDTH, PGE_HOST_SCREEN_HEIGHT);
+  for (int i = 0; i < PGE_HOST_SCREEN_WIDTH * PGE_HOST_SCREEN_HEIGHT; i++) {
+    GColor8 color = {.argb = s_frame_buffer_data[i]};
+    uint8_t rgb[3] = { color.r * 85, color.g * 85, color.b * 85 };
+    fwrite(rgb, 1, sizeof(rgb), file);
+  }
+  return fclose(file) == 0;
+}
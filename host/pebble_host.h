@@ -0,0 +1,19 @@
+/**
+ * Internals shared by the host runtime files, not part of the stand-in Pebble API.
+ */
+#pragma once
+
+#include <pebble.h>
+#include <stdio.h>
+
+#define PGE_HOST_SCREEN_WIDTH 144
+#define PGE_HOST_SCREEN_HEIGHT 168
+
+// Graphics context drawing into the frame buffer
+GContext* pge_host_get_context(void);
+
+// Reset the drawing state of the context for a layer at offset, clipped to clip (both in frame buffer pixels)
+void pge_host_context_begin(GContext *ctx, GPoint offset, GRect clip);
+
+// Write the frame buffer to path as a binary PPM
+bool pge_host_write_screenshot(const char *path);
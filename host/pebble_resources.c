@@ -0,0 +1,84 @@
+/**
+ * Resources of the host build, read from the files listed in appinfo.json.
+ *
+ * resource_ids.auto.h is generated by resource_ids.py, a resource is read into memory the first time
+ * its handle is requested and stays there until the process exits.
+ */
+#include "pebble_host.h"
+
+#ifndef PGE_HOST_RESOURCE_DIR
+#define PGE_HOST_RESOURCE_DIR "resources"
+#endif
+
+typedef struct {
+  const char *file;
+  uint8_t *data;
+  size_t size;
+  bool loaded;
+} HostResource;
+
+static HostResource s_resources[] = PGE_HOST_RESOURCE_FILES;
+
+#define NUM_RESOURCES (sizeof(s_resources) / sizeof(s_resources[0]))
+
+static bool prv_load(HostResource *resource) {
+  char path[1024];
+  snprintf(path, sizeof(path), "%s/%s", PGE_HOST_RESOURCE_DIR, resource->file);
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to open resource %s", path);
+    return false;
+  }
+
+  bool loaded = false;
+  long size = 0;
+  if ((fseek(file, 0, SEEK_END) == 0) && ((size = ftell(file)) >= 0) && (fseek(file, 0, SEEK_SET) == 0)) {
+    resource->data = malloc((size > 0) ? size : 1);
+    loaded = (resource->data) && (fread(resource->data, 1, size, file) == (size_t)size);
+  }
+  fclose(file);
+
+  if (!loaded) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to read resource %s", path);
+    free(resource->data);
+    resource->data = NULL;
+    return false;
+  }
+  resource->size = size;
+  resource->loaded = true;
+  return true;
+}
+
+ResHandle resource_get_handle(uint32_t resource_id) {
+  // Resource IDs start at 1
+  if ((resource_id == 0) || (resource_id > NUM_RESOURCES)) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Invalid resource ID %u", resource_id);
+    return NULL;
+  }
+
+  HostResource *resource = &s_resources[resource_id - 1];
+  if ((!resource->loaded) && (!prv_load(resource))) {
+    return NULL;
+  }
+  return resource;
+}
+
+size_t resource_size(ResHandle h) {
+  return (h) ? ((const HostResource*)h)->size : 0;
+}
+
+size_t resource_load(ResHandle h, uint8_t *buffer, size_t max_length) {
+  return resource_load_byte_range(h, 0, buffer, max_length);
+}
+
+size_t resource_load_byte_range(ResHandle h, uint32_t start_offset, uint8_t *buffer, size_t num_bytes) {
+  const HostResource *resource = h;
+  if ((!resource) || (!buffer) || (start_offset >= resource->size)) {
+    return 0;
+  }
+
+  size_t available = resource->size - start_offset;
+  size_t num_read = (num_bytes < available) ? num_bytes : available;
+  memcpy(buffer, &resource->data[start_offset], num_read);
+  return num_read;
+}
@@ -0,0 +1,29 @@
+#!/usr/bin/env python3
+"""Generate resource_ids.auto.h for the host build from the media listed in appinfo.json.
+
+Usage: resource_ids.py appinfo.json resource_ids.auto.h
+"""
+
+import json
+import sys
+
+
+def main():
+    appinfo_path, header_path = sys.argv[1:3]
+    with open(appinfo_path) as appinfo_file:
+        media = json.load(appinfo_file)['resources']['media']
+
+    lines = ['// Generated from appinfo.json by host/resource_ids.py, do not edit', '#pragma once', '']
+    for resource_id, resource in enumerate(media, 1):
+        lines.append('#define RESOURCE_ID_{} {}'.format(resource['name'], resource_id))
+    lines.append('')
+    lines.append('// Files of the resources in ID order, relative to the resources directory')
+    files = ', '.join('{{ "{}" }}'.format(resource['file']) for resource in media)
+    lines.append('#define PGE_HOST_RESOURCE_FILES {{ {} }}'.format(files))
+
+    with open(header_path, 'w') as header_file:
+        header_file.write('\n'.join(lines) + '\n')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,39 @@
+// Generated by spritesheetgen.py from mariospritesheet.tmx - do not edit
+#pragma once
+
+#define MARIOSPRITESHEET_SPRITESHEETGEN_VERSION 2
+
+// Tileset handles, usable wherever a PGETilesetHandle is expected
+#define MARIOSPRITESHEET_TILESET_MARIO_LARGE 0
+#define MARIOSPRITESHEET_TILESET_MARIO_SMALL 1
+#define MARIOSPRITESHEET_TILESET_LUIGI_LARGE 2
+#define MARIOSPRITESHEET_TILESET_MARIOTILES 3
+#define MARIOSPRITESHEET_TILESET_CLOUD 4
+#define MARIOSPRITESHEET_TILESET_PIPE 5
+#define MARIOSPRITESHEET_NUM_TILESETS 6
+
+// First global id and number of tiles of each tileset
+#define MARIOSPRITESHEET_MARIO_LARGE_FIRSTGID 1
+#define MARIOSPRITESHEET_MARIO_LARGE_NUM_TILES 21
+#define MARIOSPRITESHEET_MARIO_SMALL_FIRSTGID 22
+#define MARIOSPRITESHEET_MARIO_SMALL_NUM_TILES 14
+#define MARIOSPRITESHEET_LUIGI_LARGE_FIRSTGID 36
+#define MARIOSPRITESHEET_LUIGI_LARGE_NUM_TILES 21
+#define MARIOSPRITESHEET_MARIOTILES_FIRSTGID 120
+#define MARIOSPRITESHEET_MARIOTILES_NUM_TILES 330
+#define MARIOSPRITESHEET_CLOUD_FIRSTGID 700
+#define MARIOSPRITESHEET_CLOUD_NUM_TILES 1
+#define MARIOSPRITESHEET_PIPE_FIRSTGID 701
+#define MARIOSPRITESHEET_PIPE_NUM_TILES 2
+
+// Named tiles (Tiled tile property "name"), local ids start at 1
+#define MARIOSPRITESHEET_MARIOTILES_GROUND_LOCAL_ID 1
+#define MARIOSPRITESHEET_MARIOTILES_GROUND_GID 120
+#define MARIOSPRITESHEET_MARIOTILES_BUSH_LEFT_LOCAL_ID 309
+#define MARIOSPRITESHEET_MARIOTILES_BUSH_LEFT_GID 428
+#define MARIOSPRITESHEET_MARIOTILES_BUSH_MIDDLE_LOCAL_ID 310
+#define MARIOSPRITESHEET_MARIOTILES_BUSH_MIDDLE_GID 429
+#define MARIOSPRITESHEET_MARIOTILES_BUSH_RIGHT_LOCAL_ID 311
+#define MARIOSPRITESHEET_MARIOTILES_BUSH_RIGHT_GID 430
+#define MARIOSPRITESHEET_CLOUD_CLOUD_LOCAL_ID 1
+#define MARIOSPRITESHEET_CLOUD_CLOUD_GID 700
@@ -0,0 +1,100 @@
+#!/usr/bin/env python
+
+import png
+import struct
+import itertools
+
+from png2pblpng import grouper, NEAREST, TRUNCATE, COLOR_REDUCTION_CHOICES, DEFAULT_COLOR_REDUCTION
+from pebble_image_routines import num_colors_to_bitdepth, rgba32_triplet_to_argb8, \
+    pebble_nearest_color_to_pebble_palette, pebble_truncate_color_to_pebble_palette
+
+# GBitmapFormat values from pebble.h
+GBITMAP_FORMAT_8BIT = 1
+GBITMAP_FORMAT_1BIT_PALETTE = 2
+GBITMAP_FORMAT_2BIT_PALETTE = 3
+GBITMAP_FORMAT_4BIT_PALETTE = 4
+
+BITDEPTH_TO_FORMAT = {
+    1: GBITMAP_FORMAT_1BIT_PALETTE,
+    2: GBITMAP_FORMAT_2BIT_PALETTE,
+    4: GBITMAP_FORMAT_4BIT_PALETTE,
+    8: GBITMAP_FORMAT_8BIT
+}
+
+# Size of the raw bitmap header written in front of the palette and pixel data
+RAW_HEADER_SIZE = 8
+
+#public APIs
+def convert_png_to_pebble_raw(input_filename, output_filename,
+                              color_reduction_method=DEFAULT_COLOR_REDUCTION):
+    """
+    Converts a PNG to raw GBitmap data that can be loaded without decoding:
+      uint16_t width
+      uint16_t height
+      uint16_t row_size_bytes
+      uint8_t  format         (GBitmapFormat)
+      uint8_t  palette_size   (number of GColor8 entries that follow, 0 for GBitmapFormat8Bit)
+      uint8_t  palette[palette_size]
+      uint8_t  pixels[row_size_bytes * height]
+    Palettized rows are packed with the leftmost pixel in the most significant bits.
+    """
+    input_png = png.Reader(filename=input_filename)
+    width, height, pixels, metadata = input_png.asRGBA8()
+
+    # reduce every pixel to a pebble ARGB8 color
+    argb8_pixels = []
+    for (r, g, b, a) in grouper(itertools.chain.from_iterable(pixels), 4):
+        if color_reduction_method == NEAREST:
+            (r, g, b, a) = pebble_nearest_color_to_pebble_palette(r, g, b, a)
+        else:
+            (r, g, b, a) = pebble_truncate_color_to_pebble_palette(r, g, b, a)
+        argb8_pixels.append(rgba32_triplet_to_argb8(r, g, b, a))
+
+    palette = []
+    for argb8 in argb8_pixels:
+        if argb8 not in palette:
+            palette.append(argb8)
+
+    bitdepth = num_colors_to_bitdepth(len(palette))
+    bitmap_format = BITDEPTH_TO_FORMAT[bitdepth]
+
+    if bitdepth == 8:
+        # 8-bit bitmaps store the color directly, no palette
+        row_size_bytes = width
+        palette = []
+        data = argb8_pixels
+    else:
+        row_size_bytes = (width * bitdepth + 7) / 8
+        pixels_per_byte = 8 / bitdepth
+        data = []
+        for y in range(0, height):
+            row = [0] * row_size_bytes
+            for x in range(0, width):
+                index = palette.index(argb8_pixels[(y * width) + x])
+                shift = 8 - (bitdepth * ((x % pixels_per_byte) + 1))
+                row[x / pixels_per_byte] |= index << shift
+            data.extend(row)
+
+    with open(output_filename, 'wb') as output_file:
+        output_file.write(struct.pack("<HHHBB", width, height, row_size_bytes, bitmap_format, len(palette)))
+        output_file.write(''.join([struct.pack("<B", color) for color in palette]))
+        output_file.write(''.join([struct.pack("<B", byte) for byte in data]))
+
+
+def main():
+    import argparse
+
+    parser = argparse.ArgumentParser(
+        description='Convert PNG to raw Pebble GBitmap data')
+    parser.add_argument('input_filename', type=str, help='png file to convert')
+    parser.add_argument('output_filename', type=str, help='converted file output')
+    parser.add_argument('--color_reduction_method', metavar='method', required=False,
+                        nargs=1, default=NEAREST, choices=COLOR_REDUCTION_CHOICES,
+                        help="Method used to convert colors to Pebble's color palette, "
+                             "options are [{}, {}]".format(NEAREST, TRUNCATE))
+    args = parser.parse_args()
+    convert_png_to_pebble_raw(args.input_filename, args.output_filename, args.color_reduction_method)
+
+
+if __name__ == '__main__':
+    main()
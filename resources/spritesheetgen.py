@@ -4,8 +4,29 @@ import struct
 import os
 import argparse
 import png2pblpng
+import png2pblraw
 
-SPRITESHEETGEN_VERSION = 1
+SPRITESHEETGEN_VERSION = 2
+
+# Tile data formats of the sprite table (version 2+)
+TABLE_FORMAT_PNG = 0 # Each tile is a Pebble PNG decoded at runtime
+TABLE_FORMAT_RAW = 1 # Each tile is raw GBitmap data, see png2pblraw.py
+TABLE_FLAG_ATLAS = 0x100 # Tiles are packed into shared atlas pages, a rect per entry follows the entries
+
+DEFAULT_ATLAS_PAGE_SIZE = 128 # Width and height of atlas pages in pixels
+
+# Tilesheets are versioned separately from the sprite table. Version 3 stores a palette of the gids used
+# by the layer followed by an 8, 16 or 32-bit palette index per coordinate instead of a 32-bit gid.
+TILESHEET_VERSION = 3
+TILESHEET_FLAG_CHUNKED = 0x1 # Indices are stored in square chunks so the runtime can stream them
+TILESHEET_FLAG_SPANS = 0x2   # Only runs of non-empty tiles are stored, for sparse layers
+TILESHEET_FLAG_ANIM = 0x4    # Animation sequences of the animated tiles used by the layer follow the palette
+TILESHEET_FLAG_SOLID = 0x8   # A bit per tile telling whether it is solid follows the animations
+
+# Must match PGE_TILESHEET_CHUNK_RING_SIZE and PGE_TILESHEET_CHUNK_PREFETCH in pge_tilesheet.h
+CHUNK_RING_SIZE = 3
+CHUNK_PREFETCH = 4
+SCREEN_SIZE = (144, 168)
 
 class TableEntry(object):
   def __init__(self):
@@ -14,11 +35,14 @@ class TableEntry(object):
     self.tile_global_id = 0
     self.tile_png_offset = 0
     self.tile_png_size = 0
+    self.atlas_page = 0
+    self.atlas_rect = (0, 0, 0, 0)
 
 class SpriteTable(object):
   def __init__(self, path):
     self.path = path
     self.version = SPRITESHEETGEN_VERSION
+    self.format = TABLE_FORMAT_PNG
     self.filesize = 16 # currently 4 entries in the header of 4 bytes each
     self.header = []
     self.table_entries_size = 0
@@ -28,42 +52,343 @@ class SpriteTable(object):
     header = []
     header.append(struct.pack("<I", self.version))
     header.append(struct.pack("<I", self.filesize))
-    header.append(struct.pack("<I", self.table_entries_size)) # Reserved field
-    header.append(struct.pack("<I", 0)) # Reserved field
+    header.append(struct.pack("<I", self.table_entries_size))
+    header.append(struct.pack("<I", self.format)) # Reserved field in version 1
     self.header = ''.join(header)
 
   def add_table_entries (self, table_entry):
-    self.table_entries.append(struct.pack("<16s",table_entry.tile_name))
-    self.table_entries.append(struct.pack("<I", table_entry.tile_local_id))
-    self.table_entries.append(struct.pack("<I", table_entry.tile_global_id))
-    self.table_entries.append(struct.pack("<I", table_entry.tile_png_offset))
-    self.table_entries.append(struct.pack("<I", table_entry.tile_png_size))
+    # Entries are packed when the table is written since atlas entries only get their page data
+    # offset once their page is complete
+    self.table_entries.append(table_entry)
     self.table_entries_size += 32 # 16 bytes for name, 16 bytes for other
-    self.filesize += 32 + table_entry.tile_png_size
 
-  def pack_png_entries (self):
-    return 0
+  def pack_table_entries (self):
+    packed = []
+    for table_entry in self.table_entries:
+      packed.append(struct.pack("<16s",table_entry.tile_name))
+      packed.append(struct.pack("<I", table_entry.tile_local_id))
+      packed.append(struct.pack("<I", table_entry.tile_global_id))
+      packed.append(struct.pack("<I", table_entry.tile_png_offset))
+      packed.append(struct.pack("<I", table_entry.tile_png_size))
+    return ''.join(packed)
+
+  def pack_atlas_rects (self):
+    if not (self.format & TABLE_FLAG_ATLAS):
+      return ''
+    packed = []
+    for table_entry in self.table_entries:
+      (x, y, w, h) = table_entry.atlas_rect
+      packed.append(struct.pack("<HHHHHH", table_entry.atlas_page, x, y, w, h, 0)) # Last field reserved
+    return ''.join(packed)
 
   def write_table (self, output_filename, png_filename):
+    packed_entries = self.pack_table_entries()
+    packed_rects = self.pack_atlas_rects()
+    self.filesize += len(packed_entries) + len(packed_rects) + os.stat(png_filename).st_size
     self.add_header()
     png_file = open(png_filename, 'rb')
     with open(output_filename, 'wb') as f:
         f.write(self.header)
-        f.write(''.join(self.table_entries))
+        f.write(packed_entries)
+        f.write(packed_rects)
         f.write(png_file.read())
     f.close()
 
+class ConcatFile(object):
+  def __init__(self, filename):
+    self.filename = filename
+    self.offset = 0
+    open(filename, 'wb').close()
+
+  # Appends converted tile or page data, returns its (offset, size)
+  def append (self, data_filename):
+    data = file(data_filename, 'rb').read()
+    offset = self.offset
+    padding = (16 - (len(data) % 16)) ## Ensure alignment of PNG file is at 16 byte boundary
+    with open(self.filename, 'ab') as concat_file:
+      concat_file.write(data)
+      for x in range (0, padding):
+        byte = struct.pack("<c", '\0')
+        concat_file.write(byte)
+    self.offset += len(data) + padding
+    return (offset, len(data))
+
+class AtlasPage(object):
+  def __init__(self, page_num, width, height):
+    self.page_num = page_num
+    self.image = Image.new("RGBA", (width, height), (0, 0, 0, 0))
+    self.table_entries = []
+    self.x = 0
+    self.y = 0
+    self.row_height = 0
+
+  # Shelf packing: tiles fill a row left to right and a new row starts below the tallest tile
+  # Returns the position of the tile in the page or None if the page is full
+  def add_tile (self, tile_image):
+    (w, h) = tile_image.size
+    if self.x + w > self.image.size[0]:
+      self.x = 0
+      self.y += self.row_height
+      self.row_height = 0
+    if (self.x + w > self.image.size[0]) or (self.y + h > self.image.size[1]):
+      return None
+    position = (self.x, self.y)
+    self.image.paste(tile_image, position)
+    self.x += w
+    self.row_height = max(self.row_height, h)
+    return position
+
+def convert_tile (input_filename, output_filename, args):
+  if args.raw:
+    png2pblraw.convert_png_to_pebble_raw(input_filename, output_filename)
+  else:
+    png2pblpng.convert_png_to_pebble_png(input_filename, output_filename)
+
+def c_identifier (name):
+  identifier = ''
+  for c in name.upper():
+    if c.isalnum():
+      identifier += c
+    else:
+      identifier += '_'
+  return identifier
+
+def write_header (world_map, header_filename, prefix):
+  # Tileset handles match the order of the tileset directory that pge_spritesheet_load_table
+  # builds, which is the order the tilesets are written to the table
+  lines = []
+  lines.append("// Generated by spritesheetgen.py from " + os.path.basename(world_map.map_file_name) + " - do not edit")
+  lines.append("#pragma once")
+  lines.append("")
+  lines.append("#define " + prefix + "_SPRITESHEETGEN_VERSION " + str(SPRITESHEETGEN_VERSION))
+  lines.append("")
+  lines.append("// Tileset handles, usable wherever a PGETilesetHandle is expected")
+  tileset_num = 0
+  for tileset in world_map.tile_sets:
+    lines.append("#define " + prefix + "_TILESET_" + c_identifier(tileset.name) + " " + str(tileset_num))
+    tileset_num += 1
+  lines.append("#define " + prefix + "_NUM_TILESETS " + str(tileset_num))
+  lines.append("")
+  lines.append("// First global id and number of tiles of each tileset")
+  for tileset in world_map.tile_sets:
+    image = tileset.images[0]
+    tileset_prefix = prefix + "_" + c_identifier(tileset.name)
+    lines.append("#define " + tileset_prefix + "_FIRSTGID " + str(int(tileset.firstgid)))
+    lines.append("#define " + tileset_prefix + "_NUM_TILES " + str(int(image.width) * int(image.height)))
+  lines.append("")
+  lines.append("// Named tiles (Tiled tile property \"name\"), local ids start at 1")
+  for tileset in world_map.tile_sets:
+    for tile in tileset.tiles:
+      if not tile.properties.get("name"):
+        continue
+      tile_prefix = prefix + "_" + c_identifier(tileset.name) + "_" + c_identifier(tile.properties.get("name"))
+      lines.append("#define " + tile_prefix + "_LOCAL_ID " + str(int(tile.id) + 1))
+      lines.append("#define " + tile_prefix + "_GID " + str(int(tileset.firstgid) + int(tile.id)))
+  lines.append("")
+
+  with open(header_filename, 'w') as f:
+    f.write('\n'.join(lines))
+
+def tilesheet_index_width (palette_size):
+  if palette_size <= 0x100:
+    return 1
+  elif palette_size <= 0x10000:
+    return 2
+  return 4
+
+def tilesheet_chunks (layer, chunk_shift):
+  # Chunks are ordered left to right and top to bottom, edge chunks are padded with the empty tile
+  chunk_side = 1 << chunk_shift
+  num_chunks_x = (layer.width + chunk_side - 1) / chunk_side
+  num_chunks_y = (layer.height + chunk_side - 1) / chunk_side
+  gids = []
+  for chunk_y in range(0, num_chunks_y):
+    for chunk_x in range(0, num_chunks_x):
+      for y in range(chunk_y * chunk_side, (chunk_y + 1) * chunk_side):
+        for x in range(chunk_x * chunk_side, (chunk_x + 1) * chunk_side):
+          if (x < layer.width) and (y < layer.height):
+            gids.append(layer.decoded_content[(y * layer.width) + x])
+          else:
+            gids.append(0)
+  return gids
+
+def tilesheet_spans (layer):
+  # Runs of non-empty tiles of each row as (x, length, first_index), plus the first span of each row
+  row_spans = []
+  spans = []
+  gids = []
+  for y in range(0, layer.height):
+    row_spans.append(len(spans))
+    x = 0
+    while x < layer.width:
+      if layer.decoded_content[(y * layer.width) + x] == 0:
+        x += 1
+        continue
+      start = x
+      while (x < layer.width) and (x - start < 0xFFFF) and (layer.decoded_content[(y * layer.width) + x] != 0):
+        gids.append(layer.decoded_content[(y * layer.width) + x])
+        x += 1
+      spans.append((start, x - start, len(gids) - (x - start)))
+  row_spans.append(len(spans))
+  return (row_spans, spans, gids)
+
+def tile_animations (world_map):
+  # {gid: [(frame gid, duration in ms)]} of every animated tile
+  animations = {}
+  for tileset in world_map.tile_sets:
+    for tile in tileset.tiles:
+      if tile.animation:
+        firstgid = int(tileset.firstgid)
+        animations[firstgid + int(tile.id)] = [(firstgid + tileid, duration) for (tileid, duration) in tile.animation]
+  return animations
+
+def is_true (value):
+  return str(value).lower() in ("1", "true", "yes")
+
+def solid_tiles (world_map):
+  # gids of the tiles with the "solid" property
+  solid = set()
+  for tileset in world_map.tile_sets:
+    for tile in tileset.tiles:
+      if is_true(tile.properties.get("solid", "false")):
+        solid.add(int(tileset.firstgid) + int(tile.id))
+  return solid
+
+def tilesheet_solid_mask (layer, solid):
+  # A layer with the "solid" property makes all of its tiles solid
+  layer_solid = is_true(layer.properties.get("solid", "false"))
+  row_bytes = (layer.width + 7) / 8
+  mask = []
+  any_solid = False
+  for y in range(0, layer.height):
+    row = [0] * row_bytes
+    for x in range(0, layer.width):
+      gid = layer.decoded_content[(y * layer.width) + x]
+      if (gid != 0) and (layer_solid or (gid in solid)):
+        row[x / 8] |= 1 << (x % 8)
+        any_solid = True
+    mask.extend(row)
+  return mask if any_solid else []
+
+def write_tilesheet (layer, tilesheet_filename, chunk_size=0, sparse=False, animations={}, solid=set()):
+  # Animated tiles used by the layer, their frames need palette entries too
+  used_gids = set(layer.decoded_content) - set([0])
+  layer_animations = [(gid, animations[gid]) for gid in sorted(used_gids) if gid in animations]
+  for (gid, frames) in layer_animations:
+    used_gids |= set([frame_gid for (frame_gid, duration) in frames])
+
+  # palette[0] is always the empty tile (gid 0), the rest is sorted so the loader can search it
+  palette = [0] + sorted(used_gids)
+  palette_index = dict((gid, index) for (index, gid) in enumerate(palette))
+  index_width = tilesheet_index_width(len(palette))
+  index_format = {1: "<B", 2: "<H", 4: "<I"}[index_width]
+
+  flags = 0
+  chunk_shift = 0
+  gids = layer.decoded_content
+  anim_data = []
+  if layer_animations:
+    # uint16 num_animations, uint16 num_frames, then the animations and the frames
+    flags |= TILESHEET_FLAG_ANIM
+    num_frames = sum([len(frames) for (gid, frames) in layer_animations])
+    anim_data.append(struct.pack("<HH", len(layer_animations), num_frames))
+    first_frame = 0
+    for (gid, frames) in layer_animations:
+      duration = sum([frame_duration for (frame_gid, frame_duration) in frames])
+      anim_data.append(struct.pack("<IHHI", palette_index[gid], first_frame, len(frames), duration))
+      first_frame += len(frames)
+    for (gid, frames) in layer_animations:
+      for (frame_gid, frame_duration) in frames:
+        anim_data.append(struct.pack("<II", palette_index[frame_gid], frame_duration))
+
+  solid_data = []
+  solid_mask = tilesheet_solid_mask(layer, solid)
+  if solid_mask:
+    flags |= TILESHEET_FLAG_SOLID
+    solid_data.append(''.join([struct.pack("<B", byte) for byte in solid_mask]))
+
+  span_data = []
+  if sparse:
+    flags |= TILESHEET_FLAG_SPANS
+    (row_spans, spans, gids) = tilesheet_spans(layer)
+    span_data.append(struct.pack("<II", len(spans), len(gids)))
+    for row_span in row_spans:
+      span_data.append(struct.pack("<I", row_span))
+    for (x, length, first_index) in spans:
+      span_data.append(struct.pack("<HHI", x, length, first_index))
+  elif chunk_size:
+    flags |= TILESHEET_FLAG_CHUNKED
+    chunk_shift = chunk_size.bit_length() - 1
+    gids = tilesheet_chunks(layer, chunk_shift)
+
+  # 16 byte header + 8 byte compact header + 4 bytes per palette entry + index_width bytes per coordinate
+  filesize = 16 + 8 + (4 * len(palette)) + len(''.join(anim_data)) + len(''.join(solid_data)) + len(''.join(span_data)) + (index_width * len(gids))
+  data = []
+  data.append(struct.pack("<I", TILESHEET_VERSION))
+  data.append(struct.pack("<I", filesize))     # file size in bytes
+  data.append(struct.pack("<I", layer.width))  # width in tiles
+  data.append(struct.pack("<I", layer.height)) # height in tiles
+  data.append(struct.pack("<BBH", index_width, chunk_shift, flags)) # index width in bytes, log2 of chunk side, flags
+  data.append(struct.pack("<I", len(palette)))
+  for gid in palette:
+    data.append(struct.pack("<I", gid))
+  data.extend(anim_data)
+  data.extend(solid_data)
+  data.extend(span_data)
+  for gid in gids:
+    data.append(struct.pack(index_format, palette_index[gid]))
+
+  tilesheet_file = open(tilesheet_filename, 'wb')
+  tilesheet_file.write(''.join(data))
+  tilesheet_file.close()
+
+def min_chunk_size (tile_width, tile_height):
+  # The tiles visible on screen plus the prefetch margin on both sides must span at most CHUNK_RING_SIZE chunks
+  # whatever their alignment, i.e. span - 1 <= chunk_size * (CHUNK_RING_SIZE - 1)
+  visible = max(((SCREEN_SIZE[0] + tile_width - 1) / tile_width) + 1, ((SCREEN_SIZE[1] + tile_height - 1) / tile_height) + 1)
+  span = visible + (2 * CHUNK_PREFETCH)
+  chunk_size = 1
+  while chunk_size * (CHUNK_RING_SIZE - 1) < span - 1:
+    chunk_size *= 2
+  return chunk_size
+
 def parse_and_build_spritesheet (tmx_file, args):
   world_map = tmxparser.TileMapParser().parse_decode(tmx_file)
+  if args.chunk_size:
+    min_size = min_chunk_size(world_map.tilewidth, world_map.tileheight)
+    if args.chunk_size < min_size:
+      parser.error('chunk_size must be at least ' + str(min_size) + ' for the ' + str(world_map.tilewidth) + 'x' +
+                   str(world_map.tileheight) + ' tiles of ' + tmx_file + ', smaller chunks are reloaded every frame')
   concat_filename = os.path.splitext(tmx_file)[0] + ".png.dat"
   tilesets_filename = os.path.splitext(tmx_file)[0] + "_tilesets.dat"
+  header_filename = os.path.splitext(tmx_file)[0] + "_tilesets.h"
   temp_files = []
   sprite_table = SpriteTable(tmx_file)
+  if args.raw:
+    sprite_table.format = TABLE_FORMAT_RAW
+  if args.atlas:
+    sprite_table.format |= TABLE_FLAG_ATLAS
 
   ### Build Tilesets Data File
-  open(concat_filename, 'wb').close()
-  png_offset = 0
+  concat_file = ConcatFile(concat_filename)
   temp_files.append(concat_filename)
+  atlas_pages = []
+
+  # Converts a completed atlas page and points all of its entries at the page data
+  def flush_atlas_page (page, tileset_name):
+    page_filename = tileset_name + "_page" + str(page.page_num) + ".png"
+    page_filename_converted = tileset_name + "_page" + str(page.page_num) + "-conv.png"
+    print "  Atlas page " + str(page.page_num) + ": " + page_filename
+    temp_files.append(page_filename)
+    if not args.keep_tempfiles:
+      temp_files.append(page_filename_converted)
+    page.image.save(page_filename)
+    convert_tile(page_filename, page_filename_converted, args)
+    (offset, size) = concat_file.append(page_filename_converted)
+    for table_entry in page.table_entries:
+      table_entry.tile_png_offset = offset
+      table_entry.tile_png_size = size
+
   ## BEGIN PARSE TILESETS
   for tileset in world_map.tile_sets:
     tileoffset = tmxparser.TileOffset()
@@ -98,6 +423,7 @@ def parse_and_build_spritesheet (tmx_file, args):
     #temp_files.append(cropped_filename)
     #temp_files.append(cropped_filename_converted)
 
+    atlas_page = None
     imagenum = 0
     for y in range(0, int(image.height)):
       for x in range(0, int(image.width)):
@@ -106,57 +432,60 @@ def parse_and_build_spritesheet (tmx_file, args):
                     tileoffset.y + (((int(tileset.tileheight) + yspacing) * y)),
                     tileoffset.x + (((int(tileset.tilewidth) + xspacing) * (x+1)) - xspacing),
                     tileoffset.y + (((int(tileset.tileheight) + yspacing) * (y+1)) - yspacing)]
-        cropped_filename = tileset.name + "_" + str(imagenum) + ".png"
-        cropped_filename_converted = tileset.name + "_" + str(imagenum) + "-conv.png"
-        print "  Tile " + str(imagenum) + ": " + cropped_filename
-        temp_files.append(cropped_filename)
-        if not args.keep_tempfiles:
-          temp_files.append(cropped_filename_converted)
         cropped_image = base_image.crop(crop_box)
-        cropped_image.save(cropped_filename)
-        png2pblpng.convert_png_to_pebble_png(cropped_filename,cropped_filename_converted)
-        imagenum += 1
 
         table_entry = TableEntry()
         table_entry.tile_name = tileset.name.encode('ascii', 'ignore')
-        table_entry.tile_local_id = imagenum
-        table_entry.tile_global_id = int(tileset.firstgid) + imagenum - 1
-        table_entry.tile_png_offset = png_offset
-        table_entry.tile_png_size = os.stat(cropped_filename_converted).st_size
-        padding = (16 - (table_entry.tile_png_size % 16)) ## Ensure alignment of PNG file is at 16 byte boundary
-        png_offset += table_entry.tile_png_size + padding
-
+        table_entry.tile_local_id = imagenum + 1
+        table_entry.tile_global_id = int(tileset.firstgid) + imagenum
         sprite_table.add_table_entries(table_entry)
 
-        concat_file = open(concat_filename, 'ab')
-        concat_file.write(file(cropped_filename_converted, 'rb').read())
-        for x in range (0, padding):
-          byte = struct.pack("<c", '\0')
-          concat_file.write(byte)
-        concat_file.close()
+        if args.atlas:
+          # Pack the tile into the current page of this tileset, starting a new page when full
+          position = None
+          if atlas_page:
+            position = atlas_page.add_tile(cropped_image)
+          if position is None:
+            if atlas_page:
+              flush_atlas_page(atlas_page, tileset.name)
+            (w, h) = cropped_image.size
+            atlas_page = AtlasPage(len(atlas_pages), max(args.atlas_page_size, w), max(args.atlas_page_size, h))
+            atlas_pages.append(atlas_page)
+            position = atlas_page.add_tile(cropped_image)
+          table_entry.atlas_page = atlas_page.page_num
+          table_entry.atlas_rect = (position[0], position[1], cropped_image.size[0], cropped_image.size[1])
+          atlas_page.table_entries.append(table_entry)
+        else:
+          cropped_filename = tileset.name + "_" + str(imagenum) + ".png"
+          cropped_filename_converted = tileset.name + "_" + str(imagenum) + "-conv.png"
+          print "  Tile " + str(imagenum) + ": " + cropped_filename
+          temp_files.append(cropped_filename)
+          if not args.keep_tempfiles:
+            temp_files.append(cropped_filename_converted)
+          cropped_image.save(cropped_filename)
+          convert_tile(cropped_filename, cropped_filename_converted, args)
+          (table_entry.tile_png_offset, table_entry.tile_png_size) = concat_file.append(cropped_filename_converted)
+        imagenum += 1
+
+    if atlas_page:
+      flush_atlas_page(atlas_page, tileset.name)
   ## END PARSE TILESETS
 
   print "Creating sprite tilesets: " + tilesets_filename
   sprite_table.write_table(tilesets_filename, concat_filename)
 
+  print "Creating tileset header: " + header_filename
+  write_header(world_map, header_filename, c_identifier(os.path.basename(os.path.splitext(tmx_file)[0])))
+
   ### Build Tilesheets for each layer
+  animations = tile_animations(world_map)
+  solid = solid_tiles(world_map)
   layer_num = 0
   for layer in world_map.layers:
     tilesheet_filename = os.path.splitext(tmx_file)[0] + "_tilesheet" + str(layer_num) + ".dat"
-    tilesheet_file = open(tilesheet_filename, 'wb')
-    header = []
-    filesize = 16 + (4 * layer.width * layer.height) # 16 byte header + 4 bytes per coordinate 
-    header.append(struct.pack("<I", SPRITESHEETGEN_VERSION))
-    header.append(struct.pack("<I", filesize))     # file size in bytes
-    header.append(struct.pack("<I", layer.width))  # width in tiles
-    header.append(struct.pack("<I", layer.height)) # height in tiles
-    tilesheet_file.write(''.join(header))
-    gid_list = []
-    for gid in layer.decoded_content:
-      gid_list.append(struct.pack("<I", gid))
-
-    tilesheet_file.write(''.join(gid_list))
-    tilesheet_file.close()
+    print "Creating tilesheet: " + tilesheet_filename
+    write_tilesheet(layer, tilesheet_filename, args.chunk_size, args.sparse, animations, solid)
+    layer_num += 1
 
   print "Cleaning up temp files"
   for temp_file in temp_files:
@@ -166,8 +495,19 @@ def parse_and_build_spritesheet (tmx_file, args):
 parser = argparse.ArgumentParser(description='Create PNG data file for a sprite sheet')
 parser.add_argument('-tmx', '--tmx', dest='tmx_file', nargs="*", required=True, help='TMX filepath')
 parser.add_argument('-tempfiles', '--tempfiles', dest='keep_tempfiles', action='store_true', default=False, help='Keep temp files')
+parser.add_argument('-atlas', '--atlas', dest='atlas', action='store_true', default=False, help='Pack the tiles of each tileset into shared atlas pages')
+parser.add_argument('-atlas_page_size', '--atlas_page_size', dest='atlas_page_size', type=int, default=DEFAULT_ATLAS_PAGE_SIZE, help='Width and height of atlas pages in pixels')
+parser.add_argument('-raw', '--raw', dest='raw', action='store_true', default=False, help='Store tiles as raw GBitmap data instead of PNG (larger resource, no decode at runtime)')
+parser.add_argument('-chunk_size', '--chunk_size', dest='chunk_size', type=int, default=0, help='Store tilesheets in square chunks of this many tiles per side (power of 2, at least 16 for 16x16 tiles) so large maps can be streamed')
+parser.add_argument('-sparse', '--sparse', dest='sparse', action='store_true', default=False, help='Store tilesheets as runs of non-empty tiles, for mostly empty layers (not combined with -chunk_size)')
 args = parser.parse_args()
 
+if args.sparse and args.chunk_size:
+  parser.error('-sparse and -chunk_size cannot be combined')
+
+if args.chunk_size and ((args.chunk_size & (args.chunk_size - 1)) or (args.chunk_size > 128)):
+  parser.error('chunk_size must be a power of 2 no larger than 128')
+
 for tmx_file in args.tmx_file:
   parse_and_build_spritesheet(tmx_file, args)
 
@@ -274,6 +274,9 @@ class Tile(object):
             list of TileImage, either its 'id' or 'image data' will be set
         properties : dict of name:value
             the propertis set in the editor, name-value pairs
+        animation : list of (tileid, duration)
+            animation frames set in the editor, tileid is local to the tile set
+            and duration is in milliseconds
     """
 
 # [20:22]	DR0ID_: to sum up: there are two use cases,
@@ -286,6 +289,7 @@ class Tile(object):
         self.id = 0
         self.images = [] # uses TileImage but either only id will be set or image data
         self.properties = {} # {name: value}
+        self.animation = [] # [(tileid, duration)]
 
 #  -----------------------------------------------------------------------------
 
@@ -677,8 +681,15 @@ class TileMapParser(object):
         self._set_attributes(tile_set_node, tile)
         for node in self._get_nodes(tile_set_node.childNodes, 'image'):
             self._build_tile_set_tile_image(node, tile)
+        for node in self._get_nodes(tile_set_node.childNodes, 'animation'):
+            self._build_tile_set_tile_animation(node, tile)
         tile_set.tiles.append(tile)
 
+    def _build_tile_set_tile_animation(self, animation_node, tile):
+        for node in self._get_nodes(animation_node.childNodes, 'frame'):
+            tile.animation.append((int(node.attributes['tileid'].nodeValue), \
+                                   int(node.attributes['duration'].nodeValue)))
+
     def _build_tile_set_tile_image(self, tile_node, tile):
         tile_image = TileImage()
         self._set_attributes(tile_node, tile_image)
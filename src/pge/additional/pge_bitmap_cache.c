@@ -0,0 +1,182 @@
+#include <pebble.h>
+#include "pge_bitmap_cache.h"
+#include "../pge_profiler.h"
+
+typedef struct PGEBitmapCacheEntry {
+  struct PGEBitmapCacheEntry *prev; // More recently used entry
+  struct PGEBitmapCacheEntry *next; // Less recently used entry
+  uintptr_t owner;
+  uint32_t id;
+  GBitmap *bitmap;
+  size_t size;                      // Approximate heap used by the bitmap and this entry
+  uint32_t ref_count;               // Number of borrowers, entry can only be evicted when 0
+} PGEBitmapCacheEntry;
+
+// Entries are kept in most recently used order, s_head is the most recently used entry
+static PGEBitmapCacheEntry *s_head = NULL;
+static PGEBitmapCacheEntry *s_tail = NULL;
+static PGEBitmapCacheStats s_stats = { .byte_budget = PGE_BITMAP_CACHE_DEFAULT_BUDGET };
+
+// Owner of entries detached by pge_bitmap_cache_flush while still borrowed, never a valid owner
+#define DETACHED_OWNER ((uintptr_t)0)
+
+static size_t prv_bitmap_size(GBitmap *bitmap) {
+  GRect bounds = gbitmap_get_bounds(bitmap);
+  return sizeof(PGEBitmapCacheEntry) + (gbitmap_get_bytes_per_row(bitmap) * bounds.size.h);
+}
+
+static void prv_unlink(PGEBitmapCacheEntry *entry) {
+  if (entry->prev) {
+    entry->prev->next = entry->next;
+  } else {
+    s_head = entry->next;
+  }
+
+  if (entry->next) {
+    entry->next->prev = entry->prev;
+  } else {
+    s_tail = entry->prev;
+  }
+
+  entry->prev = NULL;
+  entry->next = NULL;
+}
+
+static void prv_push_front(PGEBitmapCacheEntry *entry) {
+  entry->prev = NULL;
+  entry->next = s_head;
+  if (s_head) {
+    s_head->prev = entry;
+  }
+  s_head = entry;
+  if (!s_tail) {
+    s_tail = entry;
+  }
+}
+
+static void prv_destroy_entry(PGEBitmapCacheEntry *entry) {
+  prv_unlink(entry);
+  s_stats.bytes_used -= entry->size;
+  s_stats.num_entries--;
+  gbitmap_destroy(entry->bitmap);
+  PGE_PROFILER_COUNT(PGEProfilerCounterBitmapsDestroyed, 1);
+  free(entry);
+}
+
+// Evict least recently used unpinned entries until the cache is back within budget
+static void prv_trim() {
+  PGEBitmapCacheEntry *entry = s_tail;
+  while (entry && (s_stats.bytes_used > s_stats.byte_budget)) {
+    PGEBitmapCacheEntry *prev = entry->prev;
+    if (entry->ref_count == 0) {
+      prv_destroy_entry(entry);
+      s_stats.evictions++;
+    }
+    entry = prev;
+  }
+}
+
+void pge_bitmap_cache_set_budget(size_t byte_budget) {
+  s_stats.byte_budget = byte_budget;
+  prv_trim();
+}
+
+GBitmap* pge_bitmap_cache_acquire(uintptr_t owner, uint32_t id, PGEBitmapCacheLoader *loader, void *context) {
+  if (owner == DETACHED_OWNER) {
+    return NULL;
+  }
+
+  for (PGEBitmapCacheEntry *entry = s_head; entry; entry = entry->next) {
+    if ((entry->owner == owner) && (entry->id == id)) {
+      s_stats.hits++;
+      entry->ref_count++;
+      if (entry != s_head) {
+        prv_unlink(entry);
+        prv_push_front(entry);
+      }
+      return entry->bitmap;
+    }
+  }
+
+  s_stats.misses++;
+  if (!loader) {
+    return NULL;
+  }
+
+  GBitmap *bitmap = loader(owner, id, context);
+  if (!bitmap) {
+    return NULL;
+  }
+
+  PGEBitmapCacheEntry *entry = calloc(1, sizeof(PGEBitmapCacheEntry));
+  if (!entry) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to allocate bitmap cache entry");
+    gbitmap_destroy(bitmap);
+    PGE_PROFILER_COUNT(PGEProfilerCounterBitmapsDestroyed, 1);
+    return NULL;
+  }
+
+  entry->owner = owner;
+  entry->id = id;
+  entry->bitmap = bitmap;
+  entry->size = prv_bitmap_size(bitmap);
+  entry->ref_count = 1;
+  prv_push_front(entry);
+  s_stats.bytes_used += entry->size;
+  s_stats.num_entries++;
+
+  // The new entry is pinned, so only older entries can be evicted
+  prv_trim();
+
+  return bitmap;
+}
+
+bool pge_bitmap_cache_release(GBitmap *bitmap) {
+  if (!bitmap) {
+    return false;
+  }
+
+  for (PGEBitmapCacheEntry *entry = s_head; entry; entry = entry->next) {
+    if (entry->bitmap == bitmap) {
+      if (entry->ref_count > 0) {
+        entry->ref_count--;
+      }
+      if ((entry->ref_count == 0) && (entry->owner == DETACHED_OWNER)) {
+        // The owner is gone, nothing can acquire this bitmap again
+        prv_destroy_entry(entry);
+      } else if (entry->ref_count == 0) {
+        prv_trim();
+      }
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void pge_bitmap_cache_flush(uintptr_t owner) {
+  PGEBitmapCacheEntry *entry = s_head;
+  while (entry) {
+    PGEBitmapCacheEntry *next = entry->next;
+    if (entry->owner == owner) {
+      if (entry->ref_count == 0) {
+        prv_destroy_entry(entry);
+      } else {
+        // Still borrowed, the entry is destroyed on its last release. It must not be found by a new
+        // owner that happens to get the same handle.
+        entry->owner = DETACHED_OWNER;
+      }
+    }
+    entry = next;
+  }
+}
+
+PGEBitmapCacheStats pge_bitmap_cache_get_stats() {
+  return s_stats;
+}
+
+void pge_bitmap_cache_reset_stats() {
+  s_stats.hits = 0;
+  s_stats.misses = 0;
+  s_stats.evictions = 0;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <pebble.h>
+
+// Bitmap Cache - A bounded LRU cache of decoded GBitmaps keyed by (owner, id). For sprite tables the
+// owner is the PGESpriteTableHandle and the id is the global tile id. Bitmaps returned by
+// pge_bitmap_cache_acquire are borrowed: they stay pinned in the cache until every acquire has been
+// matched by a pge_bitmap_cache_release, and only unpinned bitmaps are evicted when the cache grows
+// beyond its byte budget.
+
+#define PGE_BITMAP_CACHE_DEFAULT_BUDGET (8 * 1024)
+
+// Cache statistics
+typedef struct {
+  uint32_t hits;        // Number of acquires served without decoding
+  uint32_t misses;      // Number of acquires that had to call the loader
+  uint32_t evictions;   // Number of bitmaps destroyed to stay within the byte budget
+  uint32_t num_entries; // Number of bitmaps currently held by the cache
+  size_t bytes_used;    // Approximate heap used by the bitmaps currently held by the cache
+  size_t byte_budget;   // Byte budget of the cache
+} PGEBitmapCacheStats;
+
+// Function that creates the bitmap for a given (owner, id) pair on a cache miss. The cache takes
+// ownership of the returned GBitmap.
+typedef GBitmap* (PGEBitmapCacheLoader)(uintptr_t owner, uint32_t id, void *context);
+
+//! Sets the maximum number of bytes of decoded bitmaps kept by the cache. Unpinned bitmaps are
+//! evicted immediately if the cache is already over the new budget.
+//! @param byte_budget Budget in bytes, 0 disables caching of unpinned bitmaps
+void pge_bitmap_cache_set_budget(size_t byte_budget);
+
+//! Gets a bitmap from the cache, calling the loader to create it if it is not present
+//! @param owner Owner of the bitmap (e.g. PGESpriteTableHandle), never 0
+//! @param id Identifier of the bitmap within the owner (e.g. tile global id)
+//! @param loader Function called to create the bitmap on a miss
+//! @param context Context passed to the loader
+//! @return Borrowed pointer to the bitmap, NULL if the loader failed. Must be returned with
+//!         pge_bitmap_cache_release
+GBitmap* pge_bitmap_cache_acquire(uintptr_t owner, uint32_t id, PGEBitmapCacheLoader *loader, void *context);
+
+//! Returns a bitmap previously obtained with pge_bitmap_cache_acquire. The bitmap stays cached
+//! until it is evicted.
+//! @param bitmap Bitmap to release
+//! @return true if the bitmap belongs to the cache, false otherwise
+bool pge_bitmap_cache_release(GBitmap *bitmap);
+
+//! Destroys all unpinned bitmaps of a given owner, e.g. when a sprite table is unloaded. Bitmaps
+//! still borrowed are detached from the owner and destroyed on their last release.
+//! @param owner Owner of the bitmaps to destroy
+void pge_bitmap_cache_flush(uintptr_t owner);
+
+//! Gets the current statistics of the cache
+//! @return Copy of the cache statistics
+PGEBitmapCacheStats pge_bitmap_cache_get_stats();
+
+//! Resets the hit, miss and eviction counters of the cache
+void pge_bitmap_cache_reset_stats();
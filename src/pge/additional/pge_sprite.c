@@ -1,13 +1,28 @@
 #include <pebble.h>
 #include "pge_sprite.h"
 #include "pge_collision.h"
+#include "pge_bitmap_cache.h"
+#include "../pge.h"
+#include "../pge_profiler.h"
+
+static void prv_release_bitmap(PGESprite *this) {
+  if (this->owns_bitmap) {
+    PGE_PROFILER_COUNT(PGEProfilerCounterBitmapsDestroyed, (this->bitmap) ? 1 : 0);
+    gbitmap_destroy(this->bitmap);
+  } else {
+    pge_bitmap_cache_release(this->bitmap);
+  }
+  this->bitmap = NULL;
+}
 
 PGESprite* pge_sprite_create(GPoint position, int initial_resource_id) {
   PGESprite *this = malloc(sizeof(PGESprite));
 
   // Allocate
   this->bitmap = gbitmap_create_with_resource(initial_resource_id);
+  PGE_PROFILER_COUNT(PGEProfilerCounterBitmapsCreated, (this->bitmap) ? 1 : 0);
   this->position = position;
+  this->owns_bitmap = true;
 
   // Finally
   return this;
@@ -19,10 +34,14 @@ PGESprite* pge_sprite_create_from_png_data(GPoint position, const uint8_t * png_
 
   // Allocate
   this->bitmap = gbitmap_create_from_png_data(png_data, png_data_size);
+  PGE_PROFILER_COUNT(PGEProfilerCounterPNGDecodes, 1);
   if (this->bitmap == NULL) {
     APP_LOG(APP_LOG_LEVEL_DEBUG, "Could not create bitmap");
+  } else {
+    PGE_PROFILER_COUNT(PGEProfilerCounterBitmapsCreated, 1);
   }
   this->position = position;
+  this->owns_bitmap = true;
 
   // Finally
   return this;
@@ -31,16 +50,42 @@ PGESprite* pge_sprite_create_from_png_data(GPoint position, const uint8_t * png_
 #endif
 }
 
+PGESprite* pge_sprite_create_with_bitmap(GPoint position, GBitmap *bitmap, bool owns_bitmap) {
+  PGESprite *this = malloc(sizeof(PGESprite));
+  if (!this) {
+    if (owns_bitmap) {
+      gbitmap_destroy(bitmap);
+    } else {
+      pge_bitmap_cache_release(bitmap);
+    }
+    return NULL;
+  }
+
+  this->bitmap = bitmap;
+  this->position = position;
+  this->owns_bitmap = owns_bitmap;
+
+  // Finally
+  return this;
+}
+
 void pge_sprite_destroy(PGESprite *this) {
-  gbitmap_destroy(this->bitmap);
-  this->bitmap = NULL;
+  prv_release_bitmap(this);
 
   free(this);
 }
 
 void pge_sprite_set_anim_frame(PGESprite *this, int resource_id) {
-  gbitmap_destroy(this->bitmap);
+  prv_release_bitmap(this);
   this->bitmap = gbitmap_create_with_resource(resource_id);
+  PGE_PROFILER_COUNT(PGEProfilerCounterBitmapsCreated, (this->bitmap) ? 1 : 0);
+  this->owns_bitmap = true;
+}
+
+void pge_sprite_set_bitmap(PGESprite *this, GBitmap *bitmap, bool owns_bitmap) {
+  prv_release_bitmap(this);
+  this->bitmap = bitmap;
+  this->owns_bitmap = owns_bitmap;
 }
 
 void pge_sprite_draw(PGESprite *this, GContext *ctx) {
@@ -49,7 +94,14 @@ void pge_sprite_draw(PGESprite *this, GContext *ctx) {
 #elif PBL_PLATFORM_BASALT
   GRect bounds = gbitmap_get_bounds(this->bitmap);
 #endif
-  graphics_draw_bitmap_in_rect(ctx, this->bitmap, GRect(this->position.x, this->position.y, bounds.size.w, bounds.size.h));
+
+  // Sprites outside of the camera view are not drawn
+  GRect frame;
+  if (!pge_camera_cull(GRect(this->position.x, this->position.y, bounds.size.w, bounds.size.h), &frame)) {
+    return;
+  }
+  graphics_draw_bitmap_in_rect(ctx, this->bitmap, frame);
+  PGE_PROFILER_COUNT(PGEProfilerCounterSpritesDrawn, 1);
 }
 
 void pge_sprite_set_position(PGESprite *this, GPoint new_position) {
@@ -13,6 +13,7 @@
 typedef struct {
   GBitmap *bitmap;
   GPoint position;
+  bool owns_bitmap;   // false if the bitmap is borrowed (e.g. from the bitmap cache or a sprite table atlas)
 } PGESprite;
 
 /**
@@ -22,6 +23,12 @@ PGESprite* pge_sprite_create(GPoint position, int initial_resource_id);
 
 PGESprite* pge_sprite_create_from_png_data(GPoint position, const uint8_t * png_data, size_t png_data_size);
 
+/**
+ * Create a sprite object using an existing bitmap
+ * If owns_bitmap is false the bitmap is borrowed: it is released to the bitmap cache (if it came from it) instead of destroyed
+ */
+PGESprite* pge_sprite_create_with_bitmap(GPoint position, GBitmap *bitmap, bool owns_bitmap);
+
 /**
  * Destroy a sprite object
  */
@@ -32,6 +39,11 @@ void pge_sprite_destroy(PGESprite *this);
  */
 void pge_sprite_set_anim_frame(PGESprite *this, int resource_id);
 
+/**
+ * Replace the sprite's bitmap, destroying or releasing the previous one
+ */
+void pge_sprite_set_bitmap(PGESprite *this, GBitmap *bitmap, bool owns_bitmap);
+
 /**
  * Draw the sprite's bitmap to the graphics context
  */
@@ -1,26 +1,95 @@
 #include <pebble.h>
 #include "pge_spritesheet.h"
+#include "../pge.h"
+#include "../pge_profiler.h"
 
 #define TILE_NAME_MAX_SIZE 16
 typedef struct {
   char tile_name[TILE_NAME_MAX_SIZE];
   uint32_t tile_local_id;
   uint32_t tile_global_id;
-  uint32_t tile_png_offset;
-  uint32_t tile_png_size;
+  uint32_t tile_png_offset;   // Offset of the tile data (PNG or raw) from the end of the table entries
+  uint32_t tile_png_size;     // Size of the tile data
 } PGESpriteTableEntry;
 
+#define SPRITE_TABLE_VERSION_MAX 2
+
+// Format of the tile data following the table entries (version 2+, always PNG in version 1)
+#define SPRITE_TABLE_FORMAT_MASK 0xFF
+#define SPRITE_TABLE_FORMAT_PNG 0 // Pebble PNG, decoded with gbitmap_create_from_png_data
+#define SPRITE_TABLE_FORMAT_RAW 1 // PGESpriteTableRawHeader followed by the palette and pixel data
+
+// Tiles are packed into atlas pages. Entries of a page share the page data and a
+// PGESpriteTableAtlasRect per entry follows the table entries.
+#define SPRITE_TABLE_FLAG_ATLAS 0x100
+
 typedef struct {
   uint32_t version;
   uint32_t filesize;
   uint32_t table_entries_size;
-  uint32_t reserved;
+  uint32_t format;              // Reserved in version 1
 } PGESpriteTableHeader;
 
+// Header of a tile stored as raw GBitmap data
+typedef struct {
+  uint16_t width;
+  uint16_t height;
+  uint16_t row_size_bytes;  // Bytes per row of the pixel data
+  uint8_t format;           // GBitmapFormat of the pixel data
+  uint8_t palette_size;     // Number of GColor8 palette entries between the header and the pixel data
+} __attribute__((__packed__)) PGESpriteTableRawHeader;
+
+// Location of a tile within its atlas page
+typedef struct {
+  uint16_t page;
+  uint16_t x;
+  uint16_t y;
+  uint16_t w;
+  uint16_t h;
+  uint16_t reserved;
+} PGESpriteTableAtlasRect;
+
+#define INVALID_ENTRY_INDEX 0xFFFF
+
+typedef struct {
+  PGESpriteSheet *spritesheet;
+  uint32_t set_index;
+  uint32_t sprite_index;
+  GPoint position;
+  int16_t z;
+} PGESpriteRenderEntry;
+
+struct PGESpriteRenderList {
+  PGESpriteRenderEntry *entries;
+  uint32_t capacity;
+  uint32_t num_entries;       // Entries submitted since the last draw
+  GRect viewport;             // Entries entirely outside of the viewport are culled
+  uint32_t num_drawn;         // Entries drawn by the last pge_spritesheet_draw_batch
+  uint32_t num_culled;        // Entries culled by the last pge_spritesheet_draw_batch
+};
+
+// Range of global ids covered by one tileset of the sprite table
+typedef struct {
+  char tile_name[TILE_NAME_MAX_SIZE];
+  uint32_t firstgid;    // Global id of local id 1
+  uint32_t num_tiles;   // Number of tiles in the tileset
+} PGESpriteTableTileset;
+
 typedef struct {
   PGESpriteTableHeader header;
   int resource_id;
   PGESpriteTableEntry *table_entries;
+  uint32_t num_entries;
+  uint32_t num_tilesets;
+  PGESpriteTableTileset *tilesets;  // Tileset directory in table order
+  uint32_t min_gid;                 // Lowest global id in the table
+  uint32_t gid_index_size;          // Number of slots in gid_index
+  uint16_t *gid_index;              // Dense map of (global id - min_gid) to index in table_entries
+  uint32_t data_offset;             // Offset of the tile data in the resource
+  PGESpriteTableAtlasRect *atlas_rects; // Rect of each entry within its atlas page, atlas tables only
+  uint32_t num_atlas_pages;
+  GBitmap **atlas_pages;            // Decoded atlas pages, loaded on first use
+  GBitmap **atlas_sub_bitmaps;      // Persistent sub-bitmap of each entry, created on first use
 } PGESpriteTable;
 
 PGESpriteSheet* pge_spritesheet_create(int resource_id, int num_sets) {
@@ -36,6 +105,7 @@ PGESpriteSheet* pge_spritesheet_create(int resource_id, int num_sets) {
     APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to create bitmap for spritesheet");
     goto cleanup;
   }
+  PGE_PROFILER_COUNT(PGEProfilerCounterBitmapsCreated, 1);
 
   this->sets = calloc(num_sets, sizeof(PGESpriteSet));
   if (!this->sets) {
@@ -64,8 +134,19 @@ void pge_spritesheet_destroy(PGESpriteSheet *this) {
     return;
   }
 
+  // Sub bitmaps reference the sprite sheet bitmap, destroy them first
+  if (this->sets) {
+    for (uint32_t set_index = 0; set_index < this->num_sets; set_index++) {
+      if (this->sets[set_index].sub_bitmap) {
+        gbitmap_destroy(this->sets[set_index].sub_bitmap);
+        PGE_PROFILER_COUNT(PGEProfilerCounterBitmapsDestroyed, 1);
+      }
+    }
+  }
+
   if (this->bitmap) {
     gbitmap_destroy(this->bitmap);
+    PGE_PROFILER_COUNT(PGEProfilerCounterBitmapsDestroyed, 1);
   }
 
   if (this->sets) {
@@ -169,9 +250,9 @@ void pge_spritesheet_set_sprite_position(PGESpriteSheet *spritesheet, uint32_t s
   spritesheet->sets[set_index].position = position;
 }
 
-static GRect prv_get_sprite_frame(PGESpriteSet *spriteset) {
-  uint32_t row = spriteset->sprite_index / spriteset->num_sprites_in_row;
-  uint32_t col = spriteset->sprite_index % spriteset->num_sprites_in_row;
+static GRect prv_get_sprite_frame(PGESpriteSet *spriteset, uint32_t sprite_index) {
+  uint32_t row = sprite_index / spriteset->num_sprites_in_row;
+  uint32_t col = sprite_index % spriteset->num_sprites_in_row;
 
   // Sprite frame will be a relative offset from the origin of the main sprite sheet bitmap
   // spriteset->frame.origin is the offset of the spriteset
@@ -195,6 +276,38 @@ GRect pge_spritesheet_get_sprite_bounds(PGESpriteSheet *spritesheet, uint32_t se
                spritesheet->sets[set_index].sprite_size.h);
 }
 
+// Draw one sprite of a sprite set at a world position using the set's persistent sub bitmap,
+// returns false if the sprite is outside of the camera view
+static bool prv_draw_sprite(GContext *ctx, PGESpriteSheet *spritesheet, PGESpriteSet *spriteset, uint32_t sprite_index, GPoint position) {
+  // Reject sprites outside of the camera view before touching the sub bitmap
+  GRect sprite_frame;
+  if (!pge_camera_cull(GRect(position.x, position.y, spriteset->sprite_size.w, spriteset->sprite_size.h), &sprite_frame)) {
+    return false;
+  }
+
+  // Get rectangle for sub bitmap within the sprite sheet based on the index within spriteset
+  GRect sub_bitmap_frame = prv_get_sprite_frame(spriteset, sprite_index);
+
+  // Create the sub bitmap out of the main sprite sheet once, then only move its bounds
+  if (!spriteset->sub_bitmap) {
+    spriteset->sub_bitmap = gbitmap_create_as_sub_bitmap(spritesheet->bitmap, sub_bitmap_frame);
+    if (!spriteset->sub_bitmap) {
+      APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to create sub bitmap");
+      return false;
+    }
+    PGE_PROFILER_COUNT(PGEProfilerCounterBitmapsCreated, 1);
+    spriteset->sub_bitmap_index = sprite_index;
+  } else if (spriteset->sub_bitmap_index != sprite_index) {
+    gbitmap_set_bounds(spriteset->sub_bitmap, sub_bitmap_frame);
+    spriteset->sub_bitmap_index = sprite_index;
+  }
+
+  // Draw sprite at appropriate position
+  graphics_draw_bitmap_in_rect(ctx, spriteset->sub_bitmap, sprite_frame);
+  PGE_PROFILER_COUNT(PGEProfilerCounterSpritesDrawn, 1);
+  return true;
+}
+
 void pge_spritesheet_draw(GContext *ctx, PGESpriteSheet *spritesheet, uint32_t set_index) {
   if ((!ctx) || (!spritesheet) || (!spritesheet->sets) || (set_index >= spritesheet->num_sets)) {
     APP_LOG(APP_LOG_LEVEL_ERROR, "Invalid params");
@@ -202,19 +315,124 @@ void pge_spritesheet_draw(GContext *ctx, PGESpriteSheet *spritesheet, uint32_t s
   }
 
   PGESpriteSet *spriteset = &spritesheet->sets[set_index];
+  prv_draw_sprite(ctx, spritesheet, spriteset, spriteset->sprite_index, spriteset->position);
+}
 
-  // Get rectangle for sub bitmap within the sprite sheet based on current index within spriteset
-  GRect sub_bitmap_frame = prv_get_sprite_frame(spriteset);
+PGESpriteRenderList* pge_spritesheet_render_list_create(uint32_t capacity) {
+  PGESpriteRenderList *this = calloc(1, sizeof(PGESpriteRenderList));
+  if (!this) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to allocate render list");
+    return NULL;
+  }
 
-  // Create a sub bitmap out of the main sprite sheet
-  GBitmap *sub_bitmap = gbitmap_create_as_sub_bitmap(spritesheet->bitmap, sub_bitmap_frame);
+  this->entries = calloc(capacity, sizeof(PGESpriteRenderEntry));
+  if (!this->entries) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to allocate render list entries");
+    free(this);
+    return NULL;
+  }
 
-  // Draw sprite at appropriate position
-  GRect sprite_frame = GRect(spriteset->position.x, spriteset->position.y, sub_bitmap_frame.size.w, sub_bitmap_frame.size.h);
-  graphics_draw_bitmap_in_rect(ctx, sub_bitmap, sprite_frame);
+  this->capacity = capacity;
+  this->viewport = PGE_RENDER_LIST_DEFAULT_VIEWPORT;
+  return this;
+}
+
+void pge_spritesheet_render_list_destroy(PGESpriteRenderList *this) {
+  if (!this) {
+    return;
+  }
+
+  if (this->entries) {
+    free(this->entries);
+  }
+  free(this);
+}
+
+void pge_spritesheet_render_list_set_viewport(PGESpriteRenderList *this, GRect viewport) {
+  if (!this) {
+    return;
+  }
+  this->viewport = viewport;
+}
+
+bool pge_spritesheet_render_list_submit(PGESpriteRenderList *this, PGESpriteSheet *spritesheet, uint32_t set_index,
+                                        uint32_t sprite_index, GPoint position, int16_t z) {
+  if ((!this) || (!spritesheet) || (!spritesheet->sets) || (set_index >= spritesheet->num_sets) ||
+      (sprite_index >= spritesheet->sets[set_index].num_sprites)) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Invalid params");
+    return false;
+  }
+
+  if (this->num_entries >= this->capacity) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Render list full");
+    return false;
+  }
+
+  PGESpriteRenderEntry *entry = &this->entries[this->num_entries++];
+  entry->spritesheet = spritesheet;
+  entry->set_index = set_index;
+  entry->sprite_index = sprite_index;
+  entry->position = position;
+  entry->z = z;
+  return true;
+}
+
+// Entries are drawn back to front by z, and by source bitmap within the same z
+static bool prv_render_entry_less(PGESpriteRenderEntry *a, PGESpriteRenderEntry *b) {
+  if (a->z != b->z) {
+    return a->z < b->z;
+  }
+  return (uintptr_t)a->spritesheet->bitmap < (uintptr_t)b->spritesheet->bitmap;
+}
+
+void pge_spritesheet_draw_batch(GContext *ctx, PGESpriteRenderList *this) {
+  if ((!ctx) || (!this)) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Invalid params");
+    return;
+  }
+
+  // Insertion sort: stable, allocation free and fast for the handful of entries submitted per frame,
+  // which are usually submitted in nearly sorted order
+  for (uint32_t i = 1; i < this->num_entries; i++) {
+    PGESpriteRenderEntry entry = this->entries[i];
+    uint32_t j = i;
+    while ((j > 0) && prv_render_entry_less(&entry, &this->entries[j - 1])) {
+      this->entries[j] = this->entries[j - 1];
+      j--;
+    }
+    this->entries[j] = entry;
+  }
+
+  this->num_drawn = 0;
+  this->num_culled = 0;
+  GRect viewport = this->viewport;
+  for (uint32_t i = 0; i < this->num_entries; i++) {
+    PGESpriteRenderEntry *entry = &this->entries[i];
+    PGESpriteSet *spriteset = &entry->spritesheet->sets[entry->set_index];
+
+    // Cull entries entirely outside of the viewport or the camera view
+    GPoint position = pge_camera_world_to_screen(entry->position);
+    if ((position.x >= viewport.origin.x + viewport.size.w) ||
+        (position.y >= viewport.origin.y + viewport.size.h) ||
+        (position.x + spriteset->sprite_size.w <= viewport.origin.x) ||
+        (position.y + spriteset->sprite_size.h <= viewport.origin.y) ||
+        (!prv_draw_sprite(ctx, entry->spritesheet, spriteset, entry->sprite_index, entry->position))) {
+      this->num_culled++;
+      continue;
+    }
+    this->num_drawn++;
+  }
+
+  // Ready for the next frame
+  this->num_entries = 0;
+}
+
+uint32_t pge_spritesheet_render_list_get_num_drawn(PGESpriteRenderList *this) {
+  return (this) ? this->num_drawn : 0;
+}
 
-  // Cleanup
-  gbitmap_destroy(sub_bitmap);
+uint32_t pge_spritesheet_render_list_get_num_culled(PGESpriteRenderList *this) {
+  return (this) ? this->num_culled : 0;
 }
 
 uint32_t pge_spritesheet_get_num_sprites(PGESpriteSheet *spritesheet, uint32_t set_index) {
@@ -226,6 +444,125 @@ uint32_t pge_spritesheet_get_num_sprites(PGESpriteSheet *spritesheet, uint32_t s
   return spritesheet->sets[set_index].num_sprites;
 }
 
+static void prv_free_index(PGESpriteTable *sprite_table) {
+  if (sprite_table->tilesets) {
+    free(sprite_table->tilesets);
+    sprite_table->tilesets = NULL;
+  }
+  if (sprite_table->gid_index) {
+    free(sprite_table->gid_index);
+    sprite_table->gid_index = NULL;
+  }
+}
+
+static size_t prv_index_size(PGESpriteTable *sprite_table) {
+  return (sprite_table->num_tilesets * sizeof(PGESpriteTableTileset)) +
+         (sprite_table->gid_index_size * sizeof(uint16_t));
+}
+
+// Build the tileset directory and the dense global id index. Entries of a tileset are stored
+// consecutively in the table, so a new tileset starts whenever the tile name changes.
+static bool prv_build_index(PGESpriteTable *sprite_table) {
+  PGESpriteTableEntry *entries = sprite_table->table_entries;
+  uint32_t num_entries = sprite_table->header.table_entries_size / sizeof(PGESpriteTableEntry);
+  if ((num_entries == 0) || (num_entries >= INVALID_ENTRY_INDEX)) {
+    return false;
+  }
+
+  uint32_t num_tilesets = 0;
+  uint32_t min_gid = entries[0].tile_global_id;
+  uint32_t max_gid = entries[0].tile_global_id;
+  for (uint32_t index = 0; index < num_entries; index++) {
+    if ((index == 0) || (strncmp(entries[index].tile_name, entries[index - 1].tile_name, TILE_NAME_MAX_SIZE) != 0)) {
+      num_tilesets++;
+    }
+    if (entries[index].tile_global_id < min_gid) {
+      min_gid = entries[index].tile_global_id;
+    }
+    if (entries[index].tile_global_id > max_gid) {
+      max_gid = entries[index].tile_global_id;
+    }
+  }
+
+  sprite_table->num_entries = num_entries;
+  sprite_table->num_tilesets = num_tilesets;
+  sprite_table->min_gid = min_gid;
+  sprite_table->gid_index_size = max_gid - min_gid + 1;
+  sprite_table->tilesets = calloc(num_tilesets, sizeof(PGESpriteTableTileset));
+  sprite_table->gid_index = malloc(sprite_table->gid_index_size * sizeof(uint16_t));
+  if (!sprite_table->tilesets || !sprite_table->gid_index) {
+    prv_free_index(sprite_table);
+    return false;
+  }
+  memset(sprite_table->gid_index, 0xFF, sprite_table->gid_index_size * sizeof(uint16_t));
+
+  PGESpriteTableTileset *tileset = NULL;
+  for (uint32_t index = 0; index < num_entries; index++) {
+    PGESpriteTableEntry *entry = &entries[index];
+    if (!tileset || (strncmp(entry->tile_name, tileset->tile_name, TILE_NAME_MAX_SIZE) != 0)) {
+      tileset = (tileset) ? tileset + 1 : &sprite_table->tilesets[0];
+      // Fixed size field, not NUL terminated when the name fills it: only read with strncmp
+      memcpy(tileset->tile_name, entry->tile_name, TILE_NAME_MAX_SIZE);
+      tileset->firstgid = entry->tile_global_id - entry->tile_local_id + 1;
+    }
+    tileset->num_tiles++;
+    sprite_table->gid_index[entry->tile_global_id - min_gid] = index;
+  }
+
+  return true;
+}
+
+static void prv_free_atlas(PGESpriteTable *sprite_table) {
+  // Sub-bitmaps reference the page data, destroy them before the pages
+  if (sprite_table->atlas_sub_bitmaps) {
+    for (uint32_t index = 0; index < sprite_table->num_entries; index++) {
+      if (sprite_table->atlas_sub_bitmaps[index]) {
+        gbitmap_destroy(sprite_table->atlas_sub_bitmaps[index]);
+        PGE_PROFILER_COUNT(PGEProfilerCounterBitmapsDestroyed, 1);
+      }
+    }
+    free(sprite_table->atlas_sub_bitmaps);
+    sprite_table->atlas_sub_bitmaps = NULL;
+  }
+  if (sprite_table->atlas_pages) {
+    for (uint32_t page = 0; page < sprite_table->num_atlas_pages; page++) {
+      if (sprite_table->atlas_pages[page]) {
+        gbitmap_destroy(sprite_table->atlas_pages[page]);
+        PGE_PROFILER_COUNT(PGEProfilerCounterBitmapsDestroyed, 1);
+      }
+    }
+    free(sprite_table->atlas_pages);
+    sprite_table->atlas_pages = NULL;
+  }
+  if (sprite_table->atlas_rects) {
+    free(sprite_table->atlas_rects);
+    sprite_table->atlas_rects = NULL;
+  }
+}
+
+// Load the atlas rect of every entry, which follow the table entries in the resource
+static bool prv_load_atlas(PGESpriteTable *sprite_table, ResHandle rh) {
+  size_t rects_size = sprite_table->num_entries * sizeof(PGESpriteTableAtlasRect);
+  sprite_table->atlas_rects = malloc(rects_size);
+  if (!sprite_table->atlas_rects) {
+    return false;
+  }
+  if (resource_load_byte_range(rh, sprite_table->data_offset, (uint8_t*)sprite_table->atlas_rects, rects_size) != rects_size) {
+    return false;
+  }
+  sprite_table->data_offset += rects_size;
+
+  for (uint32_t index = 0; index < sprite_table->num_entries; index++) {
+    if (sprite_table->atlas_rects[index].page >= sprite_table->num_atlas_pages) {
+      sprite_table->num_atlas_pages = sprite_table->atlas_rects[index].page + 1;
+    }
+  }
+
+  sprite_table->atlas_pages = calloc(sprite_table->num_atlas_pages, sizeof(GBitmap *));
+  sprite_table->atlas_sub_bitmaps = calloc(sprite_table->num_entries, sizeof(GBitmap *));
+  return (sprite_table->atlas_pages && sprite_table->atlas_sub_bitmaps);
+}
+
 PGESpriteTableHandle pge_spritesheet_load_table(int resource_id) {
   ResHandle rh = resource_get_handle(resource_id);
 
@@ -236,14 +573,26 @@ PGESpriteTableHandle pge_spritesheet_load_table(int resource_id) {
     goto cleanup;
   }
 
+  memset(sprite_table, 0, sizeof(PGESpriteTable));
   sprite_table->resource_id = resource_id;
-  sprite_table->table_entries = NULL;
   // Load the table header
   size_t header_size = sizeof(PGESpriteTableHeader);
   if (resource_load_byte_range(rh, 0, (uint8_t*)sprite_table, header_size) != header_size) {
     goto cleanup;
   }
   APP_LOG(APP_LOG_LEVEL_DEBUG, "Loaded sprite table header %ld, %ld, %ld", sprite_table->header.version, sprite_table->header.filesize, sprite_table->header.table_entries_size);
+  if (sprite_table->header.version > SPRITE_TABLE_VERSION_MAX) {
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "Unsupported sprite table version %ld", sprite_table->header.version);
+    goto cleanup;
+  }
+  if (sprite_table->header.version < 2) {
+    sprite_table->header.format = SPRITE_TABLE_FORMAT_PNG;
+  } else if ((sprite_table->header.format & ~(SPRITE_TABLE_FORMAT_MASK | SPRITE_TABLE_FLAG_ATLAS)) ||
+             (((sprite_table->header.format & SPRITE_TABLE_FORMAT_MASK) != SPRITE_TABLE_FORMAT_PNG) &&
+              ((sprite_table->header.format & SPRITE_TABLE_FORMAT_MASK) != SPRITE_TABLE_FORMAT_RAW))) {
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "Unsupported sprite table format %ld", sprite_table->header.format);
+    goto cleanup;
+  }
 
   // Load the table entries
   uint32_t table_entries_size = sprite_table->header.table_entries_size;
@@ -258,12 +607,29 @@ PGESpriteTableHandle pge_spritesheet_load_table(int resource_id) {
   }
   APP_LOG(APP_LOG_LEVEL_DEBUG, "Loaded sprite table entries %ld %ld %ld", sprite_table->table_entries[0].tile_local_id, sprite_table->table_entries[0].tile_png_offset, sprite_table->table_entries[0].tile_png_size);
 
-  sprite_table_handle = (uint32_t)sprite_table;
+  if (!prv_build_index(sprite_table)) {
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "Could not build sprite table index");
+    goto cleanup;
+  }
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "Built sprite table index: %ld tilesets, %ld bytes", sprite_table->num_tilesets, (uint32_t)prv_index_size(sprite_table));
+
+  sprite_table->data_offset = header_size + table_entries_size;
+  if (sprite_table->header.format & SPRITE_TABLE_FLAG_ATLAS) {
+    if (!prv_load_atlas(sprite_table, rh)) {
+      APP_LOG(APP_LOG_LEVEL_DEBUG, "Could not load sprite table atlas");
+      goto cleanup;
+    }
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "Loaded sprite table atlas: %ld pages", sprite_table->num_atlas_pages);
+  }
+
+  sprite_table_handle = (uintptr_t)sprite_table;
   goto done;
 
 cleanup:
   APP_LOG(APP_LOG_LEVEL_DEBUG, "Error while loading sprite table");
   if (sprite_table) {
+    prv_free_atlas(sprite_table);
+    prv_free_index(sprite_table);
     if (sprite_table->table_entries) {
       free(sprite_table->table_entries);
     }
@@ -274,132 +640,299 @@ done:
   return sprite_table_handle;
 }
 
-static PGESpriteTableEntry* prv_find_table_entry(PGESpriteTableHandle handle, char *tile_name, uint32_t tile_local_id) {
-  PGESpriteTableEntry *table_entry = NULL;
+size_t pge_spritesheet_get_table_index_size(PGESpriteTableHandle handle) {
   PGESpriteTable *sprite_table = (PGESpriteTable *)handle;
-  uint32_t num_entries = sprite_table->header.table_entries_size / sizeof(PGESpriteTableEntry);
+  if (!sprite_table) {
+    return 0;
+  }
+  return prv_index_size(sprite_table);
+}
 
-  for (uint32_t index = 0; index < num_entries; index++) {
-    if ((strncmp(sprite_table->table_entries[index].tile_name, tile_name, TILE_NAME_MAX_SIZE) == 0) &&
-        sprite_table->table_entries[index].tile_local_id == tile_local_id) {
-      table_entry = &sprite_table->table_entries[index];
-      break;
-    }
+void pge_spritesheet_unload_table(PGESpriteTableHandle handle) {
+  PGESpriteTable *sprite_table = (PGESpriteTable *)handle;
+  if (!sprite_table) {
+    return;
   }
 
-  return table_entry;
+  // Drop any decoded bitmaps of this table that are no longer borrowed by a sprite
+  pge_bitmap_cache_flush(handle);
+
+  prv_free_atlas(sprite_table);
+  prv_free_index(sprite_table);
+  if (sprite_table->table_entries) {
+    free(sprite_table->table_entries);
+  }
+  free(sprite_table);
 }
 
 static PGESpriteTableEntry* prv_find_table_entry_gid(PGESpriteTableHandle handle, uint32_t tile_global_id) {
-  PGESpriteTableEntry *table_entry = NULL;
   PGESpriteTable *sprite_table = (PGESpriteTable *)handle;
-  uint32_t num_entries = sprite_table->header.table_entries_size / sizeof(PGESpriteTableEntry);
+  if (!sprite_table || (tile_global_id < sprite_table->min_gid)) {
+    return NULL;
+  }
 
-//  APP_LOG(APP_LOG_LEVEL_ERROR, "num_entries %ld", num_entries);
-  for (uint32_t index = 0; index < num_entries; index++) {
-//    APP_LOG(APP_LOG_LEVEL_ERROR, "tile_global_id[%ld] %ld", index, sprite_table->table_entries[index].tile_global_id);
-    if (sprite_table->table_entries[index].tile_global_id == tile_global_id) {
-      table_entry = &sprite_table->table_entries[index];
-      break;
+  uint32_t slot = tile_global_id - sprite_table->min_gid;
+  if ((slot >= sprite_table->gid_index_size) || (sprite_table->gid_index[slot] == INVALID_ENTRY_INDEX)) {
+    return NULL;
+  }
+
+  return &sprite_table->table_entries[sprite_table->gid_index[slot]];
+}
+
+static PGETilesetHandle prv_find_tileset(PGESpriteTable *sprite_table, char *tile_name) {
+  for (uint32_t index = 0; index < sprite_table->num_tilesets; index++) {
+    if (strncmp(sprite_table->tilesets[index].tile_name, tile_name, TILE_NAME_MAX_SIZE) == 0) {
+      return index;
     }
   }
+  return INVALID_TILESET_HANDLE;
+}
 
-  return table_entry;
+static uint32_t prv_get_tileset_gid(PGESpriteTable *sprite_table, PGETilesetHandle tileset, uint32_t tile_local_id) {
+  if ((tileset >= sprite_table->num_tilesets) || (tile_local_id == 0) ||
+      (tile_local_id > sprite_table->tilesets[tileset].num_tiles)) {
+    return INVALID_GLOBAL_ID;
+  }
+  return sprite_table->tilesets[tileset].firstgid + tile_local_id - 1;
 }
 
-PGESprite* pge_spritesheet_create_sprite(PGESpriteTableHandle handle, char *tile_name, uint32_t tile_local_id, GPoint position) {
-  PGESprite *sprite = NULL;
-#ifdef PBL_PLATFORM_BASALT
+static PGESpriteTableEntry* prv_find_table_entry_tileset(PGESpriteTableHandle handle, PGETilesetHandle tileset, uint32_t tile_local_id) {
   PGESpriteTable *sprite_table = (PGESpriteTable *)handle;
-  PGESpriteTableEntry *table_entry = prv_find_table_entry(handle, tile_name, tile_local_id);
-  if (table_entry) {
-    //APP_LOG(APP_LOG_LEVEL_DEBUG, "Found table entry %s %ld %ld %ld", table_entry->tile_name, table_entry->tile_local_id, table_entry->tile_png_offset, table_entry->tile_png_size);
-    uint8_t *png_data = malloc(table_entry->tile_png_size);
-    uint32_t file_offset = sizeof(PGESpriteTableHeader) + sprite_table->header.table_entries_size + table_entry->tile_png_offset;
-    ResHandle rh = resource_get_handle(sprite_table->resource_id);
-    if (png_data && (resource_load_byte_range(rh, file_offset, (uint8_t*)png_data, table_entry->tile_png_size) == table_entry->tile_png_size)) {
-      //APP_LOG(APP_LOG_LEVEL_DEBUG, "Creating sprite: %s, id: %ld, offset: %ld, size: %ld", table_entry->tile_name, table_entry->tile_local_id, table_entry->tile_png_offset, table_entry->tile_png_size);
-      sprite = pge_sprite_create_from_png_data(position, png_data, table_entry->tile_png_size);
-      free(png_data);
-    } else if (png_data) {
-      free(png_data);
+  if (!sprite_table) {
+    return NULL;
+  }
+  return prv_find_table_entry_gid(handle, prv_get_tileset_gid(sprite_table, tileset, tile_local_id));
+}
+
+static PGESpriteTableEntry* prv_find_table_entry(PGESpriteTableHandle handle, char *tile_name, uint32_t tile_local_id) {
+  PGESpriteTable *sprite_table = (PGESpriteTable *)handle;
+  if (!sprite_table) {
+    return NULL;
+  }
+  return prv_find_table_entry_tileset(handle, prv_find_tileset(sprite_table, tile_name), tile_local_id);
+}
+
+PGETilesetHandle pge_spritesheet_get_tileset(PGESpriteTableHandle handle, char *tile_name) {
+  PGESpriteTable *sprite_table = (PGESpriteTable *)handle;
+  if (!sprite_table || !tile_name) {
+    return INVALID_TILESET_HANDLE;
+  }
+  return prv_find_tileset(sprite_table, tile_name);
+}
+
+uint32_t pge_spritesheet_get_tileset_gid(PGESpriteTableHandle handle, PGETilesetHandle tileset, uint32_t tile_local_id) {
+  PGESpriteTable *sprite_table = (PGESpriteTable *)handle;
+  if (!sprite_table) {
+    return INVALID_GLOBAL_ID;
+  }
+  return prv_get_tileset_gid(sprite_table, tileset, tile_local_id);
+}
+
+#ifdef PBL_PLATFORM_BASALT
+// Load the PNG data for a table entry from resources and decode it
+static GBitmap* prv_load_png_bitmap(ResHandle rh, uint32_t file_offset, PGESpriteTableEntry *table_entry) {
+  GBitmap *bitmap = NULL;
+  uint8_t *png_data = malloc(table_entry->tile_png_size);
+  if (png_data && (resource_load_byte_range(rh, file_offset, (uint8_t*)png_data, table_entry->tile_png_size) == table_entry->tile_png_size)) {
+    PGE_PROFILER_COUNT(PGEProfilerCounterResourceBytes, table_entry->tile_png_size);
+    PGE_PROFILER_BEGIN(png_decode);
+    bitmap = gbitmap_create_from_png_data(png_data, table_entry->tile_png_size);
+    PGE_PROFILER_END(png_decode);
+    PGE_PROFILER_COUNT(PGEProfilerCounterPNGDecodes, 1);
+    PGE_PROFILER_COUNT(PGEProfilerCounterBitmapsCreated, (bitmap) ? 1 : 0);
+  }
+  if (png_data) {
+    free(png_data);
+  }
+  return bitmap;
+}
+
+// Create a bitmap for a raw table entry and load the pixel data straight into it, no decode required
+static GBitmap* prv_load_raw_bitmap(ResHandle rh, uint32_t file_offset, PGESpriteTableEntry *table_entry) {
+  PGESpriteTableRawHeader raw_header;
+  if (resource_load_byte_range(rh, file_offset, (uint8_t*)&raw_header, sizeof(raw_header)) != sizeof(raw_header)) {
+    return NULL;
+  }
+  if (sizeof(raw_header) + raw_header.palette_size + (raw_header.row_size_bytes * raw_header.height) > table_entry->tile_png_size) {
+    return NULL;
+  }
+  file_offset += sizeof(raw_header);
+
+  GBitmap *bitmap = NULL;
+  GSize size = GSize(raw_header.width, raw_header.height);
+  if (raw_header.palette_size > 0) {
+    GColor *palette = malloc(raw_header.palette_size * sizeof(GColor));
+    if (!palette) {
+      return NULL;
+    }
+    if (resource_load_byte_range(rh, file_offset, (uint8_t*)palette, raw_header.palette_size) != raw_header.palette_size) {
+      free(palette);
+      return NULL;
+    }
+    file_offset += raw_header.palette_size;
+
+    // Bitmap frees the palette when destroyed
+    bitmap = gbitmap_create_blank_with_palette(size, (GBitmapFormat)raw_header.format, palette, true);
+    if (!bitmap) {
+      free(palette);
+      return NULL;
     }
   } else {
-    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to find table entry for tile local id %ld, %s", tile_local_id, tile_name);
+    bitmap = gbitmap_create_blank(size, (GBitmapFormat)raw_header.format);
+    if (!bitmap) {
+      return NULL;
+    }
   }
-#endif
-  return sprite;
+
+  // Rows can be read in one go unless the bitmap pads its rows differently
+  uint8_t *data = gbitmap_get_data(bitmap);
+  uint16_t bytes_per_row = gbitmap_get_bytes_per_row(bitmap);
+  bool loaded = true;
+  if (bytes_per_row == raw_header.row_size_bytes) {
+    size_t data_size = raw_header.row_size_bytes * raw_header.height;
+    loaded = (resource_load_byte_range(rh, file_offset, data, data_size) == data_size);
+  } else {
+    for (uint16_t row = 0; loaded && (row < raw_header.height); row++) {
+      loaded = (resource_load_byte_range(rh, file_offset + (row * raw_header.row_size_bytes),
+                                         &data[row * bytes_per_row], raw_header.row_size_bytes) == raw_header.row_size_bytes);
+    }
+  }
+
+  if (!loaded) {
+    gbitmap_destroy(bitmap);
+    bitmap = NULL;
+  }
+  PGE_PROFILER_COUNT(PGEProfilerCounterResourceBytes,
+                     sizeof(raw_header) + raw_header.palette_size + (raw_header.row_size_bytes * raw_header.height));
+  PGE_PROFILER_COUNT(PGEProfilerCounterBitmapsCreated, (bitmap) ? 1 : 0);
+  return bitmap;
 }
+#endif
 
-PGESprite* pge_spritesheet_create_sprite_gid(PGESpriteTableHandle handle, uint32_t tile_global_id, GPoint position) {
-  PGESprite *sprite = NULL;
+// Create the bitmap for a table entry from its PNG or raw data
+static GBitmap* prv_load_entry_bitmap(PGESpriteTable *sprite_table, PGESpriteTableEntry *table_entry) {
+  GBitmap *bitmap = NULL;
 #ifdef PBL_PLATFORM_BASALT
+  uint32_t file_offset = sprite_table->data_offset + table_entry->tile_png_offset;
+  ResHandle rh = resource_get_handle(sprite_table->resource_id);
+  if ((sprite_table->header.format & SPRITE_TABLE_FORMAT_MASK) == SPRITE_TABLE_FORMAT_RAW) {
+    bitmap = prv_load_raw_bitmap(rh, file_offset, table_entry);
+  } else {
+    bitmap = prv_load_png_bitmap(rh, file_offset, table_entry);
+  }
+  if (!bitmap) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to load bitmap for global id %ld", table_entry->tile_global_id);
+  }
+#endif
+  return bitmap;
+}
+
+static GBitmap* prv_cache_loader(uintptr_t owner, uint32_t id, void *context) {
+  return prv_load_entry_bitmap((PGESpriteTable *)owner, (PGESpriteTableEntry *)context);
+}
+
+// Get the persistent sub-bitmap of an atlas entry, decoding its page the first time it is used
+static GBitmap* prv_get_atlas_bitmap(PGESpriteTable *sprite_table, PGESpriteTableEntry *table_entry) {
+  uint32_t index = table_entry - sprite_table->table_entries;
+  if (sprite_table->atlas_sub_bitmaps[index]) {
+    return sprite_table->atlas_sub_bitmaps[index];
+  }
+
+  // All entries of a page point at the same page data
+  PGESpriteTableAtlasRect *rect = &sprite_table->atlas_rects[index];
+  if (!sprite_table->atlas_pages[rect->page]) {
+    sprite_table->atlas_pages[rect->page] = prv_load_entry_bitmap(sprite_table, table_entry);
+    if (!sprite_table->atlas_pages[rect->page]) {
+      return NULL;
+    }
+  }
+
+  sprite_table->atlas_sub_bitmaps[index] = gbitmap_create_as_sub_bitmap(sprite_table->atlas_pages[rect->page],
+                                                                        GRect(rect->x, rect->y, rect->w, rect->h));
+  PGE_PROFILER_COUNT(PGEProfilerCounterBitmapsCreated, (sprite_table->atlas_sub_bitmaps[index]) ? 1 : 0);
+  return sprite_table->atlas_sub_bitmaps[index];
+}
+
+// Borrow the bitmap for a table entry, either a persistent atlas sub-bitmap owned by the table or a
+// decoded bitmap from the bitmap cache
+static GBitmap* prv_acquire_entry_bitmap(PGESpriteTableHandle handle, PGESpriteTableEntry *table_entry) {
   PGESpriteTable *sprite_table = (PGESpriteTable *)handle;
+  if (sprite_table->header.format & SPRITE_TABLE_FLAG_ATLAS) {
+    return prv_get_atlas_bitmap(sprite_table, table_entry);
+  }
+  return pge_bitmap_cache_acquire(handle, table_entry->tile_global_id, prv_cache_loader, table_entry);
+}
+
+GBitmap* pge_spritesheet_acquire_bitmap_gid(PGESpriteTableHandle handle, uint32_t tile_global_id) {
+  GBitmap *bitmap = NULL;
+#ifdef PBL_PLATFORM_BASALT
   PGESpriteTableEntry *table_entry = prv_find_table_entry_gid(handle, tile_global_id);
-  if (table_entry) {
-    //APP_LOG(APP_LOG_LEVEL_DEBUG, "Found table entry %ld %ld %ld", table_entry->tile_global_id, table_entry->tile_png_offset, table_entry->tile_png_size);
-    uint8_t *png_data = malloc(table_entry->tile_png_size);
-    uint32_t file_offset = sizeof(PGESpriteTableHeader) + sprite_table->header.table_entries_size + table_entry->tile_png_offset;
-    ResHandle rh = resource_get_handle(sprite_table->resource_id);
-    if (png_data && (resource_load_byte_range(rh, file_offset, (uint8_t*)png_data, table_entry->tile_png_size) == table_entry->tile_png_size)) {
-      //APP_LOG(APP_LOG_LEVEL_DEBUG, "Creating sprite gid: %ld, offset: %ld, size: %ld", table_entry->tile_global_id, table_entry->tile_png_offset, table_entry->tile_png_size);
-      sprite = pge_sprite_create_from_png_data(position, png_data, table_entry->tile_png_size);
-      free(png_data);
-    } else if (png_data) {
-      free(png_data);
-    }
-  } else {
+  if (!table_entry) {
     APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to find table entry for global id %ld", tile_global_id);
+    return NULL;
   }
+  bitmap = prv_acquire_entry_bitmap(handle, table_entry);
 #endif
-  return sprite;
+  return bitmap;
 }
 
-void pge_spritesheet_set_anim_frame(PGESprite *this, PGESpriteTableHandle handle, char *tile_name, uint32_t tile_local_id) {
+static PGESprite* prv_create_sprite(PGESpriteTableHandle handle, PGESpriteTableEntry *table_entry, GPoint position) {
+  PGESprite *sprite = NULL;
 #ifdef PBL_PLATFORM_BASALT
-  // Destroy existing bitmap
-  gbitmap_destroy(this->bitmap);
-  this->bitmap = NULL;
+  GBitmap *bitmap = prv_acquire_entry_bitmap(handle, table_entry);
+  if (bitmap) {
+    sprite = pge_sprite_create_with_bitmap(position, bitmap, false);
+  }
+#endif
+  return sprite;
+}
 
-  // Find corresponding sprite table entry
-  PGESpriteTable *sprite_table = (PGESpriteTable *)handle;
-  PGESpriteTableEntry *table_entry = prv_find_table_entry(handle, tile_name, tile_local_id);
+static void prv_set_anim_frame(PGESprite *this, PGESpriteTableHandle handle, PGESpriteTableEntry *table_entry) {
+#ifdef PBL_PLATFORM_BASALT
+  // Acquire the new frame before releasing the current one so an unchanged frame stays cached
+  GBitmap *bitmap = NULL;
   if (table_entry) {
-    // Load up PNG data and create GBitmap
-    uint8_t *png_data = malloc(table_entry->tile_png_size);
-    uint32_t file_offset = sizeof(PGESpriteTableHeader) + sprite_table->header.table_entries_size + table_entry->tile_png_offset;
-    ResHandle rh = resource_get_handle(sprite_table->resource_id);
-    if (png_data && resource_load_byte_range(rh, file_offset, (uint8_t*)png_data, table_entry->tile_png_size) == table_entry->tile_png_size) {
-      this->bitmap = gbitmap_create_from_png_data(png_data, table_entry->tile_png_size);
-      free(png_data);
-    } else if (png_data) {
-      free(png_data);
-    }
+    bitmap = prv_acquire_entry_bitmap(handle, table_entry);
   }
+  pge_sprite_set_bitmap(this, bitmap, false);
 #endif
 }
 
-void pge_spritesheet_set_anim_frame_gid(PGESprite *this, PGESpriteTableHandle handle, uint32_t tile_global_id) {
-#ifdef PBL_PLATFORM_BASALT
-  // Destroy existing bitmap
-  gbitmap_destroy(this->bitmap);
-  this->bitmap = NULL;
+PGESprite* pge_spritesheet_create_sprite(PGESpriteTableHandle handle, char *tile_name, uint32_t tile_local_id, GPoint position) {
+  PGESpriteTableEntry *table_entry = prv_find_table_entry(handle, tile_name, tile_local_id);
+  if (!table_entry) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to find table entry for tile local id %ld, %s", tile_local_id, tile_name);
+    return NULL;
+  }
+  return prv_create_sprite(handle, table_entry, position);
+}
 
-  // Find corresponding sprite table entry
-  PGESpriteTable *sprite_table = (PGESpriteTable *)handle;
+PGESprite* pge_spritesheet_create_sprite_tileset(PGESpriteTableHandle handle, PGETilesetHandle tileset, uint32_t tile_local_id, GPoint position) {
+  PGESpriteTableEntry *table_entry = prv_find_table_entry_tileset(handle, tileset, tile_local_id);
+  if (!table_entry) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to find table entry for tile local id %ld, tileset %ld", tile_local_id, tileset);
+    return NULL;
+  }
+  return prv_create_sprite(handle, table_entry, position);
+}
+
+PGESprite* pge_spritesheet_create_sprite_gid(PGESpriteTableHandle handle, uint32_t tile_global_id, GPoint position) {
   PGESpriteTableEntry *table_entry = prv_find_table_entry_gid(handle, tile_global_id);
-  if (table_entry) {
-    // Load up PNG data and create GBitmap
-    uint8_t *png_data = malloc(table_entry->tile_png_size);
-    uint32_t file_offset = sizeof(PGESpriteTableHeader) + sprite_table->header.table_entries_size + table_entry->tile_png_offset;
-    ResHandle rh = resource_get_handle(sprite_table->resource_id);
-    if (png_data && resource_load_byte_range(rh, file_offset, (uint8_t*)png_data, table_entry->tile_png_size) == table_entry->tile_png_size) {
-      this->bitmap = gbitmap_create_from_png_data(png_data, table_entry->tile_png_size);
-      free(png_data);
-    } else if (png_data) {
-      free(png_data);
-    }
+  if (!table_entry) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to find table entry for global id %ld", tile_global_id);
+    return NULL;
   }
-#endif
+  return prv_create_sprite(handle, table_entry, position);
 }
 
+void pge_spritesheet_set_anim_frame(PGESprite *this, PGESpriteTableHandle handle, char *tile_name, uint32_t tile_local_id) {
+  prv_set_anim_frame(this, handle, prv_find_table_entry(handle, tile_name, tile_local_id));
+}
+
+void pge_spritesheet_set_anim_frame_tileset(PGESprite *this, PGESpriteTableHandle handle, PGETilesetHandle tileset, uint32_t tile_local_id) {
+  prv_set_anim_frame(this, handle, prv_find_table_entry_tileset(handle, tileset, tile_local_id));
+}
+
+void pge_spritesheet_set_anim_frame_gid(PGESprite *this, PGESpriteTableHandle handle, uint32_t tile_global_id) {
+  prv_set_anim_frame(this, handle, prv_find_table_entry_gid(handle, tile_global_id));
+}
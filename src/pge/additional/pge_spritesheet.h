@@ -2,8 +2,12 @@
  
 #include <pebble.h>
 #include "pge_sprite.h"
+#include "pge_bitmap_cache.h"
 
-typedef uint32_t PGESpriteTableHandle;
+typedef uintptr_t PGESpriteTableHandle;
+
+// Index of a tileset within a sprite table, resolved once from its name with pge_spritesheet_get_tileset
+typedef uint32_t PGETilesetHandle;
 
 // Sprite Set - This is a collection of sprites images for a given set. For example, if you have an 
 // animated sprite that is split into 16 sprites, then that set of 16 sprites can be grouped as one
@@ -21,6 +25,9 @@ typedef struct {
   uint32_t num_sprites_in_col;  // Number of sprites within a column of the sprite set
   GPoint position;              // Point on screen where to draw the sprite
   GSize sprite_size;            // Size of an individual sprite within this sprite set
+  GBitmap *sub_bitmap;          // Long-lived sub bitmap of the sprite sheet, created on first draw and
+                                // retargeted with gbitmap_set_bounds when sprite_index changes
+  uint32_t sub_bitmap_index;    // sprite_index that sub_bitmap currently points at
 } PGESpriteSet;
 
 // Sprite Sheet
@@ -32,8 +39,16 @@ typedef struct {
   PGESpriteSet *sets;   // Array of PGESpriteSet
 } PGESpriteSheet;
 
+// Render List - Collects sprites to draw during game logic so they can be drawn in one pass, sorted by z
+// (back to front) and source bitmap, with entries outside of the viewport culled before any bitmap work.
+typedef struct PGESpriteRenderList PGESpriteRenderList;
+
+#define PGE_RENDER_LIST_DEFAULT_VIEWPORT GRect(0, 0, 144, 168)
+
 #define INVALID_SET_INDEX ~(0)
 #define INVALID_SPRITE_INDEX ~(0)
+#define INVALID_TILESET_HANDLE ~(0)
+#define INVALID_GLOBAL_ID 0
 
 //! Creates an empty sprite sheet from a given resource image
 //! @param resource_id Resource id of the sprite sheet image to load
@@ -85,30 +100,114 @@ void pge_spritesheet_set_sprite_position(PGESpriteSheet *spritesheet, uint32_t s
 //!         calculated when the PGESpriteSet was created
 GRect pge_spritesheet_get_sprite_bounds(PGESpriteSheet *spritesheet, uint32_t set_index);
 
-//! Draws the sprite for a given PGESpriteSet based on the current sprite_index
+//! Draws the sprite for a given PGESpriteSet based on the current sprite_index. The sub bitmap used for
+//! drawing is kept by the PGESpriteSet, so drawing does not allocate after the first draw. The position
+//! of the PGESpriteSet is in world coordinates and goes through the camera, see pge_camera_set_position.
 //! @param spritesheet Pointer to the PGESpriteSheet
 //! @param set_index Index of the slot for the PGESpriteSet to draw
 void pge_spritesheet_draw(GContext *ctx, PGESpriteSheet *spritesheet, uint32_t set_index);
 
+//! Creates a render list
+//! @param capacity Maximum number of entries that can be submitted per frame
+//! @return Pointer to the created PGESpriteRenderList
+PGESpriteRenderList* pge_spritesheet_render_list_create(uint32_t capacity);
+
+//! Destroys and frees the memory used by the PGESpriteRenderList
+//! @param render_list Pointer to the PGESpriteRenderList to destroy
+void pge_spritesheet_render_list_destroy(PGESpriteRenderList *render_list);
+
+//! Sets the rectangle outside of which entries are culled, PGE_RENDER_LIST_DEFAULT_VIEWPORT by default
+//! @param render_list Pointer to the PGESpriteRenderList
+//! @param viewport Visible rectangle in screen coordinates
+void pge_spritesheet_render_list_set_viewport(PGESpriteRenderList *render_list, GRect viewport);
+
+//! Submits a sprite to be drawn by the next pge_spritesheet_draw_batch. Parameters are validated here so
+//! that drawing the batch does not need to.
+//! @param render_list Pointer to the PGESpriteRenderList
+//! @param spritesheet Pointer to the PGESpriteSheet
+//! @param set_index Index of the slot for the PGESpriteSet
+//! @param sprite_index Index of the sprite within the PGESpriteSet
+//! @param position Point in world coordinates where to draw the sprite, converted by the camera
+//! @param z Depth of the sprite, lower values are drawn first
+//! @return true if the entry was added, false if the parameters are invalid or the list is full
+bool pge_spritesheet_render_list_submit(PGESpriteRenderList *render_list, PGESpriteSheet *spritesheet, uint32_t set_index,
+                                        uint32_t sprite_index, GPoint position, int16_t z);
+
+//! Draws all submitted entries sorted by z and source bitmap, skipping entries outside of the viewport
+//! or the camera view, then empties the render list
+//! @param render_list Pointer to the PGESpriteRenderList to draw
+void pge_spritesheet_draw_batch(GContext *ctx, PGESpriteRenderList *render_list);
+
+//! Returns the number of entries drawn by the last pge_spritesheet_draw_batch
+//! @param render_list Pointer to the PGESpriteRenderList
+uint32_t pge_spritesheet_render_list_get_num_drawn(PGESpriteRenderList *render_list);
+
+//! Returns the number of entries culled by the last pge_spritesheet_draw_batch
+//! @param render_list Pointer to the PGESpriteRenderList
+uint32_t pge_spritesheet_render_list_get_num_culled(PGESpriteRenderList *render_list);
+
 //! Returns the number of sprites in a given PGESpriteSet pointed to by set_index
 //! @param spritesheet Pointer to the PGESpriteSheet
 //! @param set_index Index of the PGESpriteSet to update
 //! @return The number of sprites in a given PGESpriteSet pointed to by set_index
 uint32_t pge_spritesheet_get_num_sprites(PGESpriteSheet *spritesheet, uint32_t set_index);
 
-//! Loads a sprite table into memory
+//! Loads a sprite table into memory and builds its lookup index (a firstgid range directory per tileset
+//! and a dense global id to entry array) so that entries are found in constant time. Accepts version 1
+//! tables (PNG tiles) and version 2 tables with PNG or raw GBitmap tiles (spritesheetgen.py -raw),
+//! optionally packed into atlas pages (spritesheetgen.py -atlas). Atlas pages are decoded once on first
+//! use and each tile is then served as a persistent sub-bitmap owned by the table.
 //! @param resource_id Resource ID corresponding to the sprite data table
 //! @return Handle to be used to reference the sprite data table
 PGESpriteTableHandle pge_spritesheet_load_table(int resource_id);
 
-//! Create a sprite at a particular position using tileset name and local ID for a given sprite sheet
+//! Resolves a tileset name to a tileset handle. Resolve names once and use the handle in per-frame calls
+//! to avoid string compares.
+//! @param handle Handle of the sprite data table
+//! @param tile_name Name of the tileset
+//! @return Handle of the tileset, INVALID_TILESET_HANDLE if the table has no tileset with that name
+PGETilesetHandle pge_spritesheet_get_tileset(PGESpriteTableHandle handle, char *tile_name);
+
+//! Converts a tileset handle and local ID into a global ID
+//! @param handle Handle of the sprite data table
+//! @param tileset Handle of the tileset
+//! @param tile_local_id Local ID of the tile within the tileset, starting from 1
+//! @return Global ID of the tile, INVALID_GLOBAL_ID if out of range
+uint32_t pge_spritesheet_get_tileset_gid(PGESpriteTableHandle handle, PGETilesetHandle tileset, uint32_t tile_local_id);
+
+//! Returns the number of heap bytes used by the lookup index of a sprite table
+//! @param handle Handle of the sprite data table
+//! @return Size of the tileset directory and global id index in bytes
+size_t pge_spritesheet_get_table_index_size(PGESpriteTableHandle handle);
+
+//! Unloads a sprite table and drops its unused bitmaps from the bitmap cache. Sprites created from the
+//! table should be destroyed first.
+//! @param handle Handle of the sprite data table to unload
+void pge_spritesheet_unload_table(PGESpriteTableHandle handle);
+
+//! Create a sprite at a particular position using tileset name and local ID for a given sprite sheet.
+//! The sprite borrows its bitmap from the bitmap cache (see pge_bitmap_cache.h).
 PGESprite* pge_spritesheet_create_sprite(PGESpriteTableHandle handle, char *tile_name, uint32_t tile_local_id, GPoint position);
 
+//! Create a sprite at a particular position using a tileset handle and local ID for a given sprite sheet
+PGESprite* pge_spritesheet_create_sprite_tileset(PGESpriteTableHandle handle, PGETilesetHandle tileset, uint32_t tile_local_id, GPoint position);
+
 //! Create a sprite at a particular position using the global ID for a given sprite sheet
 PGESprite* pge_spritesheet_create_sprite_gid(PGESpriteTableHandle handle, uint32_t tile_global_id, GPoint position);
 
-//! Set the image (PNG) for a given sprite using the given tileset name and local ID for a given sprite sheet
+//! Borrow the decoded bitmap of a tile without creating a sprite, e.g. for tile maps
+//! @param handle Handle of the sprite table
+//! @param tile_global_id Global ID of the tile
+//! @return Borrowed bitmap, NULL if the tile cannot be found or loaded. Must be returned with
+//!         pge_bitmap_cache_release (a no-op for atlas bitmaps, which are owned by the table)
+GBitmap* pge_spritesheet_acquire_bitmap_gid(PGESpriteTableHandle handle, uint32_t tile_global_id);
+
+//! Set the image (PNG) for a given sprite using the given tileset name and local ID for a given sprite sheet.
+//! Decoded images are served from the bitmap cache, so setting the same frame again does not decode the PNG.
 void pge_spritesheet_set_anim_frame(PGESprite *this, PGESpriteTableHandle handle, char *tile_name, uint32_t tile_local_id);
 
+//! Set the image (PNG) for a given sprite using a tileset handle and local ID for a given sprite sheet
+void pge_spritesheet_set_anim_frame_tileset(PGESprite *this, PGESpriteTableHandle handle, PGETilesetHandle tileset, uint32_t tile_local_id);
+
 //! Set the image (PNG) for a given sprite using the given global ID for a given sprite sheet
 void pge_spritesheet_set_anim_frame_gid(PGESprite *this, PGESpriteTableHandle handle, uint32_t tile_global_id);
@@ -0,0 +1,194 @@
+#include <pebble.h>
+#include "pge_tilelayers.h"
+#include "pge_tilescroller.h"
+#include "../pge.h"
+
+typedef struct {
+  PGETileSheetHandle handle;  // Tile sheet of the layer
+  GRect frame;                // Rect on screen covered by the layer
+  GSize tile_size;            // Size of a tile in pixels
+  int32_t parallax;           // Fixed point factor applied to the camera, see PGE_TILELAYER_PARALLAX_ONE
+  bool visible;
+  GCompOp compositing_mode;
+#ifdef PBL_COLOR
+  PGETileScroller *scroller;  // Cached strip of the visible tiles
+#endif
+} PGETileLayer;
+
+struct PGETileLayerStack {
+  PGETileLayer *layers;       // Layers back to front
+  uint32_t num_layers;
+  uint32_t max_layers;
+  GRect viewport;             // Shared culling rect on screen
+  GPoint camera;
+  uint32_t num_skipped;       // Layers not rasterized by the last draw
+};
+
+static int32_t prv_floor_div(int32_t value, int32_t divisor) {
+  return (value >= 0) ? (value / divisor) : -((divisor - 1 - value) / divisor);
+}
+
+static GRect prv_intersect(GRect a, GRect b) {
+  int16_t x0 = (a.origin.x > b.origin.x) ? a.origin.x : b.origin.x;
+  int16_t y0 = (a.origin.y > b.origin.y) ? a.origin.y : b.origin.y;
+  int16_t x1 = (a.origin.x + a.size.w < b.origin.x + b.size.w) ? a.origin.x + a.size.w : b.origin.x + b.size.w;
+  int16_t y1 = (a.origin.y + a.size.h < b.origin.y + b.size.h) ? a.origin.y + a.size.h : b.origin.y + b.size.h;
+  return ((x1 > x0) && (y1 > y0)) ? GRect(x0, y0, x1 - x0, y1 - y0) : GRectZero;
+}
+
+static PGETileLayer* prv_get_layer(PGETileLayerStack *this, uint32_t layer_index) {
+  if ((!this) || (layer_index >= this->num_layers)) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Invalid layer index %ld", layer_index);
+    return NULL;
+  }
+  return &this->layers[layer_index];
+}
+
+PGETileLayerStack* pge_tilelayers_create(uint32_t max_layers, GRect viewport) {
+  PGETileLayerStack *this = calloc(1, sizeof(PGETileLayerStack));
+  if (!this) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to allocate tile layer stack");
+    return NULL;
+  }
+
+  this->layers = calloc(max_layers, sizeof(PGETileLayer));
+  if (!this->layers) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to allocate tile layers");
+    free(this);
+    return NULL;
+  }
+
+  this->max_layers = max_layers;
+  this->viewport = viewport;
+  return this;
+}
+
+void pge_tilelayers_destroy(PGETileLayerStack *this) {
+  if (!this) {
+    return;
+  }
+
+#ifdef PBL_COLOR
+  for (uint32_t i = 0; i < this->num_layers; i++) {
+    pge_tilescroller_destroy(this->layers[i].scroller);
+  }
+#endif
+  free(this->layers);
+  free(this);
+}
+
+uint32_t pge_tilelayers_add_layer(PGETileLayerStack *this, PGETileSheetHandle handle, GRect frame, GSize tile_size,
+                                  int32_t parallax) {
+  if ((!this) || (!handle) || (tile_size.w <= 0) || (tile_size.h <= 0)) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Invalid params");
+    return INVALID_LAYER_INDEX;
+  }
+
+  if (this->num_layers >= this->max_layers) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Tile layer stack full");
+    return INVALID_LAYER_INDEX;
+  }
+
+  PGETileLayer *layer = &this->layers[this->num_layers];
+  memset(layer, 0, sizeof(PGETileLayer));
+
+#ifdef PBL_COLOR
+  // The strip only needs to cover the part of the layer that can be visible
+  GRect strip_frame = prv_intersect(frame, this->viewport);
+  if (strip_frame.size.w > 0) {
+    layer->scroller = pge_tilescroller_create(handle, strip_frame, tile_size);
+    if (!layer->scroller) {
+      return INVALID_LAYER_INDEX;
+    }
+  }
+#endif
+
+  layer->handle = handle;
+  layer->frame = frame;
+  layer->tile_size = tile_size;
+  layer->parallax = parallax;
+  layer->visible = true;
+  layer->compositing_mode = GCompOpSet;
+  return this->num_layers++;
+}
+
+void pge_tilelayers_set_visible(PGETileLayerStack *this, uint32_t layer_index, bool visible) {
+  PGETileLayer *layer = prv_get_layer(this, layer_index);
+  if (layer) {
+    layer->visible = visible;
+  }
+}
+
+void pge_tilelayers_set_compositing_mode(PGETileLayerStack *this, uint32_t layer_index, GCompOp mode) {
+  PGETileLayer *layer = prv_get_layer(this, layer_index);
+  if (layer) {
+    layer->compositing_mode = mode;
+  }
+}
+
+void pge_tilelayers_set_parallax(PGETileLayerStack *this, uint32_t layer_index, int32_t parallax) {
+  PGETileLayer *layer = prv_get_layer(this, layer_index);
+  if (layer) {
+    layer->parallax = parallax;
+  }
+}
+
+void pge_tilelayers_set_camera(PGETileLayerStack *this, GPoint camera) {
+  if (!this) {
+    return;
+  }
+  this->camera = camera;
+}
+
+uint32_t pge_tilelayers_draw(GContext *ctx, PGETileLayerStack *this) {
+  if ((!ctx) || (!this)) {
+    return 0;
+  }
+
+  uint32_t num_drawn = 0;
+  this->num_skipped = 0;
+  for (uint32_t i = 0; i < this->num_layers; i++) {
+    PGETileLayer *layer = &this->layers[i];
+    if (!layer->visible) {
+      continue;
+    }
+
+    // Shared culling, layers entirely outside of the viewport cost nothing
+    GRect visible_frame = prv_intersect(layer->frame, this->viewport);
+    if (visible_frame.size.w == 0) {
+      continue;
+    }
+
+    GPoint offset = GPoint(prv_floor_div(this->camera.x * layer->parallax, PGE_TILELAYER_PARALLAX_ONE),
+                           prv_floor_div(this->camera.y * layer->parallax, PGE_TILELAYER_PARALLAX_ONE));
+
+    graphics_context_set_compositing_mode(ctx, layer->compositing_mode);
+#ifdef PBL_COLOR
+    // The scroller only rasterizes the tiles exposed since its last draw, nothing when the offset is unchanged
+    pge_tilescroller_set_camera(layer->scroller, GPoint(offset.x + (visible_frame.origin.x - layer->frame.origin.x),
+                                                        offset.y + (visible_frame.origin.y - layer->frame.origin.y)));
+    uint32_t num_rasterized = pge_tilescroller_draw(ctx, layer->scroller);
+    if (num_rasterized == 0) {
+      this->num_skipped++;
+    }
+    num_drawn += num_rasterized;
+#else
+    // Layer frames are on screen, draw_grid takes world positions that go through the camera. The tile sheet can
+    // be shared, its viewport is only narrowed to the layer for this draw
+    GSize size = pge_tilesheet_get_tilesheet_size(layer->handle);
+    GRect viewport = pge_tilesheet_get_viewport(layer->handle);
+    pge_tilesheet_set_viewport(layer->handle, visible_frame);
+    GPoint position = pge_camera_screen_to_world(GPoint(layer->frame.origin.x - offset.x,
+                                                        layer->frame.origin.y - offset.y));
+    num_drawn += pge_tilesheet_draw_grid(ctx, layer->handle, GRect(0, 0, size.w, size.h), position, layer->tile_size);
+    pge_tilesheet_set_viewport(layer->handle, viewport);
+#endif
+  }
+
+  graphics_context_set_compositing_mode(ctx, GCompOpAssign);
+  return num_drawn;
+}
+
+uint32_t pge_tilelayers_get_num_skipped(PGETileLayerStack *this) {
+  return (this) ? this->num_skipped : 0;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <pebble.h>
+#include "pge_tilesheet.h"
+
+// Tile Layer Stack - Draws several tile sheets (e.g. one per TMX layer) back to front in one pass. Each
+// layer scrolls with the camera multiplied by its parallax factor, can be hidden and has its own
+// compositing mode. On color platforms each layer keeps a PGETileScroller, so a layer whose scroll offset
+// did not change since the last frame is not rasterized again, only its cached strip is drawn.
+
+typedef struct PGETileLayerStack PGETileLayerStack;
+
+#define INVALID_LAYER_INDEX ~(0)
+
+// Parallax factors are fixed point, PGE_TILELAYER_PARALLAX_ONE scrolls at the speed of the camera,
+// PGE_TILELAYER_PARALLAX_ONE / 2 at half speed and 0 not at all
+#define PGE_TILELAYER_PARALLAX_ONE 256
+
+/**
+ * Create an empty layer stack that can hold max_layers layers.
+ * viewport is the rect on screen outside of which nothing is drawn.
+ */
+PGETileLayerStack* pge_tilelayers_create(uint32_t max_layers, GRect viewport);
+
+/**
+ * Destroy a layer stack. The tile sheets of the layers are not destroyed.
+ */
+void pge_tilelayers_destroy(PGETileLayerStack *this);
+
+/**
+ * Add a layer on top of the existing ones.
+ * frame is the rect on screen covered by the layer, the tile sheet position (0, 0) is drawn at its top left
+ * when the layer offset is (0, 0). tile_size is the size in pixels of a tile.
+ * Returns the index of the layer, INVALID_LAYER_INDEX if the stack is full or the layer cannot be created.
+ */
+uint32_t pge_tilelayers_add_layer(PGETileLayerStack *this, PGETileSheetHandle handle, GRect frame, GSize tile_size,
+                                  int32_t parallax);
+
+/**
+ * Show or hide a layer, hidden layers cost nothing
+ */
+void pge_tilelayers_set_visible(PGETileLayerStack *this, uint32_t layer_index, bool visible);
+
+/**
+ * Set the compositing mode used to draw a layer, GCompOpSet (the default) keeps transparent pixels of
+ * the tiles, GCompOpAssign is faster for opaque layers
+ */
+void pge_tilelayers_set_compositing_mode(PGETileLayerStack *this, uint32_t layer_index, GCompOp mode);
+
+/**
+ * Set the parallax factor of a layer
+ */
+void pge_tilelayers_set_parallax(PGETileLayerStack *this, uint32_t layer_index, int32_t parallax);
+
+/**
+ * Set the camera position in pixels, each layer is offset by the camera times its parallax factor
+ */
+void pge_tilelayers_set_camera(PGETileLayerStack *this, GPoint camera);
+
+/**
+ * Draw all visible layers back to front. Leaves the compositing mode of ctx set to GCompOpAssign.
+ * Returns the number of tiles drawn or rasterized.
+ */
+uint32_t pge_tilelayers_draw(GContext *ctx, PGETileLayerStack *this);
+
+/**
+ * Get the number of visible layers the last pge_tilelayers_draw did not rasterize any tile of, because their
+ * cached strip was up to date. Always 0 on black and white platforms, where layers are redrawn every time.
+ */
+uint32_t pge_tilelayers_get_num_skipped(PGETileLayerStack *this);
@@ -0,0 +1,272 @@
+#ifdef PBL_COLOR
+
+#include "pge_tilescroller.h"
+#include "../pge_profiler.h"
+
+struct PGETileScroller {
+  PGETileSheetHandle handle;  // Tile sheet drawn by the scroller
+  GRect frame;                // Rect on screen covered by the strip
+  GSize tile_size;            // Size of a tile in pixels
+  GPoint camera;              // Tile map position shown at the top left of the frame
+  GPoint strip_camera;        // Tile map position currently rasterized at the top left of the strip
+  bool strip_valid;           // False when the whole strip has to be rasterized
+  uint32_t anim_serial;       // Tile sheet animation serial the strip is up to date with
+  GBitmap *strip;             // 8-bit off-screen copy of the visible tiles, transparent where there are no tiles
+};
+
+// Read one pixel of a tile bitmap as an 8-bit color
+static uint8_t prv_get_pixel(uint8_t *data, uint16_t row_size, GBitmapFormat format, GColor *palette, int x, int y) {
+  uint8_t *row = &data[y * row_size];
+  switch (format) {
+    case GBitmapFormat8Bit:
+      return row[x];
+    case GBitmapFormat1BitPalette:
+      return palette[(row[x >> 3] >> (7 - (x & 7))) & 0x1].argb;
+    case GBitmapFormat2BitPalette:
+      return palette[(row[x >> 2] >> (6 - ((x & 3) << 1))) & 0x3].argb;
+    case GBitmapFormat4BitPalette:
+      return palette[(row[x >> 1] >> (4 - ((x & 1) << 2))) & 0xF].argb;
+    case GBitmapFormat1Bit:
+      return ((row[x >> 3] >> (x & 7)) & 0x1) ? GColorWhite.argb : GColorBlack.argb;
+    default:
+      return GColorClear.argb;
+  }
+}
+
+// Copy the part of a tile bitmap starting at (src_x, src_y) to the strip at (dst_x, dst_y)
+static void prv_blit_tile(PGETileScroller *this, GBitmap *tile, int src_x, int src_y, int dst_x, int dst_y, int w, int h) {
+  GRect bounds = gbitmap_get_bounds(tile);
+  if (src_x + w > bounds.size.w) {
+    w = bounds.size.w - src_x;
+  }
+  if (src_y + h > bounds.size.h) {
+    h = bounds.size.h - src_y;
+  }
+
+  uint8_t *data = gbitmap_get_data(tile);
+  uint16_t row_size = gbitmap_get_bytes_per_row(tile);
+  GBitmapFormat format = gbitmap_get_format(tile);
+  GColor *palette = gbitmap_get_palette(tile);
+  uint8_t *strip_data = gbitmap_get_data(this->strip);
+  uint16_t strip_row_size = gbitmap_get_bytes_per_row(this->strip);
+
+  // Sub bitmaps (e.g. atlas tiles) share the data of their parent, offset by their bounds
+  src_x += bounds.origin.x;
+  src_y += bounds.origin.y;
+  for (int y = 0; y < h; y++) {
+    uint8_t *dst = &strip_data[((dst_y + y) * strip_row_size) + dst_x];
+    if (format == GBitmapFormat8Bit) {
+      memcpy(dst, &data[((src_y + y) * row_size) + src_x], w);
+      continue;
+    }
+    for (int x = 0; x < w; x++) {
+      dst[x] = prv_get_pixel(data, row_size, format, palette, src_x + x, src_y + y);
+    }
+  }
+}
+
+static int prv_floor_div(int value, int divisor) {
+  return (value >= 0) ? (value / divisor) : -((divisor - 1 - value) / divisor);
+}
+
+// Rasterize all tiles overlapping a rect of the strip, returns the number of tiles drawn
+static uint32_t prv_rasterize(PGETileScroller *this, GRect region) {
+  if ((region.size.w <= 0) || (region.size.h <= 0)) {
+    return 0;
+  }
+
+  uint8_t *strip_data = gbitmap_get_data(this->strip);
+  uint16_t strip_row_size = gbitmap_get_bytes_per_row(this->strip);
+  for (int y = region.origin.y; y < region.origin.y + region.size.h; y++) {
+    memset(&strip_data[(y * strip_row_size) + region.origin.x], GColorClear.argb, region.size.w);
+  }
+
+  int tile_w = this->tile_size.w;
+  int tile_h = this->tile_size.h;
+  int world_x = this->strip_camera.x + region.origin.x;
+  int world_y = this->strip_camera.y + region.origin.y;
+  int first_col = prv_floor_div(world_x, tile_w);
+  int last_col = prv_floor_div(world_x + region.size.w - 1, tile_w);
+  int first_row = prv_floor_div(world_y, tile_h);
+  int last_row = prv_floor_div(world_y + region.size.h - 1, tile_h);
+
+  uint32_t num_drawn = 0;
+  for (int row = first_row; row <= last_row; row++) {
+    for (int col = first_col; col <= last_col; col++) {
+      GBitmap *tile = pge_tilesheet_get_tile_bitmap(this->handle, GPoint(col, row));
+      if (!tile) {
+        continue;
+      }
+
+      // Intersect the tile with the region, in tile map pixels
+      int x0 = col * tile_w;
+      int y0 = row * tile_h;
+      int x1 = x0 + tile_w;
+      int y1 = y0 + tile_h;
+      int clip_x0 = (x0 > world_x) ? x0 : world_x;
+      int clip_y0 = (y0 > world_y) ? y0 : world_y;
+      int clip_x1 = (x1 < world_x + region.size.w) ? x1 : world_x + region.size.w;
+      int clip_y1 = (y1 < world_y + region.size.h) ? y1 : world_y + region.size.h;
+
+      prv_blit_tile(this, tile, clip_x0 - x0, clip_y0 - y0,
+                    clip_x0 - this->strip_camera.x, clip_y0 - this->strip_camera.y,
+                    clip_x1 - clip_x0, clip_y1 - clip_y0);
+      num_drawn++;
+    }
+  }
+  return num_drawn;
+}
+
+// Rasterize again the visible tiles whose animation frame changed since the strip was last updated
+static uint32_t prv_update_animated(PGETileScroller *this, int first_col, int first_row, int last_col, int last_row) {
+  uint32_t num_drawn = 0;
+  GRect strip_bounds = GRect(0, 0, this->frame.size.w, this->frame.size.h);
+  for (int row = first_row; row <= last_row; row++) {
+    for (int col = first_col; col <= last_col; col++) {
+      if (pge_tilesheet_get_tile_anim_serial(this->handle, GPoint(col, row)) <= this->anim_serial) {
+        continue;
+      }
+
+      GRect cell = GRect((col * this->tile_size.w) - this->strip_camera.x, (row * this->tile_size.h) - this->strip_camera.y,
+                         this->tile_size.w, this->tile_size.h);
+      grect_clip(&cell, &strip_bounds);
+      num_drawn += prv_rasterize(this, cell);
+    }
+  }
+  return num_drawn;
+}
+
+// Move the strip contents by the camera delta and rasterize what was exposed
+static uint32_t prv_scroll(PGETileScroller *this, int dx, int dy) {
+  int w = this->frame.size.w;
+  int h = this->frame.size.h;
+  uint8_t *strip_data = gbitmap_get_data(this->strip);
+  uint16_t strip_row_size = gbitmap_get_bytes_per_row(this->strip);
+
+  if (dy > 0) {
+    memmove(strip_data, &strip_data[dy * strip_row_size], (h - dy) * strip_row_size);
+  } else if (dy < 0) {
+    memmove(&strip_data[-dy * strip_row_size], strip_data, (h + dy) * strip_row_size);
+  }
+
+  if (dx != 0) {
+    for (int y = 0; y < h; y++) {
+      uint8_t *row = &strip_data[y * strip_row_size];
+      if (dx > 0) {
+        memmove(row, &row[dx], w - dx);
+      } else {
+        memmove(&row[-dx], row, w + dx);
+      }
+    }
+  }
+
+  this->strip_camera = this->camera;
+  uint32_t num_drawn = 0;
+  if (dy > 0) {
+    num_drawn += prv_rasterize(this, GRect(0, h - dy, w, dy));
+  } else if (dy < 0) {
+    num_drawn += prv_rasterize(this, GRect(0, 0, w, -dy));
+  }
+  if (dx > 0) {
+    num_drawn += prv_rasterize(this, GRect(w - dx, 0, dx, h));
+  } else if (dx < 0) {
+    num_drawn += prv_rasterize(this, GRect(0, 0, -dx, h));
+  }
+  return num_drawn;
+}
+
+PGETileScroller* pge_tilescroller_create(PGETileSheetHandle handle, GRect frame, GSize tile_size) {
+  if ((!handle) || (frame.size.w <= 0) || (frame.size.h <= 0) || (tile_size.w <= 0) || (tile_size.h <= 0)) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Invalid params");
+    return NULL;
+  }
+
+  PGETileScroller *this = calloc(1, sizeof(PGETileScroller));
+  if (!this) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to allocate tile scroller");
+    return NULL;
+  }
+
+  this->strip = gbitmap_create_blank(frame.size, GBitmapFormat8Bit);
+  if (!this->strip) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to allocate tile scroller strip");
+    free(this);
+    return NULL;
+  }
+  PGE_PROFILER_COUNT(PGEProfilerCounterBitmapsCreated, 1);
+
+  this->handle = handle;
+  this->frame = frame;
+  this->tile_size = tile_size;
+  return this;
+}
+
+void pge_tilescroller_destroy(PGETileScroller *this) {
+  if (!this) {
+    return;
+  }
+
+  if (this->strip) {
+    gbitmap_destroy(this->strip);
+    PGE_PROFILER_COUNT(PGEProfilerCounterBitmapsDestroyed, 1);
+  }
+  free(this);
+}
+
+void pge_tilescroller_set_camera(PGETileScroller *this, GPoint camera) {
+  if (!this) {
+    return;
+  }
+  this->camera = camera;
+}
+
+GPoint pge_tilescroller_get_camera(PGETileScroller *this) {
+  return (this) ? this->camera : GPointZero;
+}
+
+void pge_tilescroller_invalidate(PGETileScroller *this) {
+  if (!this) {
+    return;
+  }
+  this->strip_valid = false;
+}
+
+uint32_t pge_tilescroller_draw(GContext *ctx, PGETileScroller *this) {
+  if ((!ctx) || (!this)) {
+    return 0;
+  }
+
+  // Keep the chunks around the visible tiles of chunked tile sheets resident
+  int first_col = prv_floor_div(this->camera.x, this->tile_size.w);
+  int first_row = prv_floor_div(this->camera.y, this->tile_size.h);
+  int last_col = prv_floor_div(this->camera.x + this->frame.size.w - 1, this->tile_size.w);
+  int last_row = prv_floor_div(this->camera.y + this->frame.size.h - 1, this->tile_size.h);
+  pge_tilesheet_stream(this->handle, GRect(first_col, first_row, last_col - first_col + 1, last_row - first_row + 1));
+
+  uint32_t anim_serial = pge_tilesheet_update_animations(this->handle);
+
+  uint32_t num_drawn = 0;
+  int dx = this->camera.x - this->strip_camera.x;
+  int dy = this->camera.y - this->strip_camera.y;
+  if ((!this->strip_valid) || (abs(dx) >= this->frame.size.w) || (abs(dy) >= this->frame.size.h)) {
+    // Nothing of the strip can be reused
+    this->strip_camera = this->camera;
+    num_drawn = prv_rasterize(this, GRect(0, 0, this->frame.size.w, this->frame.size.h));
+    this->strip_valid = true;
+  } else {
+    if ((dx != 0) || (dy != 0)) {
+      num_drawn = prv_scroll(this, dx, dy);
+    }
+    // Only animated tiles whose frame changed this tick are redrawn
+    if (anim_serial != this->anim_serial) {
+      num_drawn += prv_update_animated(this, first_col, first_row, last_col, last_row);
+    }
+  }
+  this->anim_serial = anim_serial;
+
+  graphics_draw_bitmap_in_rect(ctx, this->strip, this->frame);
+  PGE_PROFILER_COUNT(PGEProfilerCounterTilesDrawn, num_drawn);
+  return num_drawn;
+}
+
+#endif
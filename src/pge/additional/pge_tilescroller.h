@@ -0,0 +1,50 @@
+/*
+ * Scroll-cached tile map renderer. Currently color only!
+ *
+ * Keeps the visible part of a PGETileSheet in an off-screen 8-bit strip bitmap. When the camera
+ * moves the strip is shifted in place and only the tile columns and rows that scroll into view are
+ * rasterized, so a static tile layer costs a memmove plus the newly exposed tiles per frame.
+ */
+#ifdef PBL_COLOR
+
+#pragma once
+
+#include <pebble.h>
+#include "pge_tilesheet.h"
+
+typedef struct PGETileScroller PGETileScroller;
+
+/**
+ * Create a scroller for a tile sheet.
+ * frame is the rect on screen covered by the tile map, tile_size the size in pixels of a tile.
+ * Returns NULL if the strip bitmap cannot be allocated.
+ */
+PGETileScroller* pge_tilescroller_create(PGETileSheetHandle handle, GRect frame, GSize tile_size);
+
+/**
+ * Destroy a scroller and its strip bitmap. The tile sheet is not destroyed.
+ */
+void pge_tilescroller_destroy(PGETileScroller *this);
+
+/**
+ * Set the position in tile map pixels shown at the top left of the frame
+ */
+void pge_tilescroller_set_camera(PGETileScroller *this, GPoint camera);
+
+/**
+ * Get the position in tile map pixels shown at the top left of the frame
+ */
+GPoint pge_tilescroller_get_camera(PGETileScroller *this);
+
+/**
+ * Force the whole strip to be rasterized again on the next draw, e.g. after tiles changed
+ */
+void pge_tilescroller_invalidate(PGETileScroller *this);
+
+/**
+ * Bring the strip up to date with the camera and draw it in the frame.
+ * Returns the number of tiles rasterized to update the strip.
+ */
+uint32_t pge_tilescroller_draw(GContext *ctx, PGETileScroller *this);
+
+#endif
@@ -1,9 +1,20 @@
 #include <pebble.h>
 #include "pge_tilesheet.h"
 #include "pge_spritesheet.h"
+#include "../pge.h"
+#include "../pge_profiler.h"
 
 #define INVALID_GLOBAL_TILE_ID 0 // This equates to not drawing anything in the tile map
 
+#define TILESHEET_VERSION_COMPACT 3 // First version storing palette indices instead of global ids
+
+#define LEGACY_LOAD_CHUNK 32 // Number of global ids read at a time when converting version 1/2 files
+
+#define TILESHEET_FLAG_CHUNKED 0x1 // Indices are stored in square chunks of (1 << chunk_shift) tiles per side
+#define TILESHEET_FLAG_SPANS   0x2 // Only the indices of runs of non-empty tiles are stored, see PGETileSheetSpan
+#define TILESHEET_FLAG_ANIM    0x4 // Animation sequences follow the palette, see PGETileSheetAnimation
+#define TILESHEET_FLAG_SOLID   0x8 // A bit per tile telling whether it is solid follows the animations
+
 typedef struct {
   uint32_t version;
   uint32_t filesize;  // Size of the tilesheet data file
@@ -11,22 +22,550 @@ typedef struct {
   uint32_t height;    // Number of tiles
 } PGETileSheetHeader;
 
+// Follows PGETileSheetHeader from version 3, then palette_size global ids and width * height indices.
+// Chunked tile sheets store the indices chunk by chunk instead, left to right and top to bottom, with
+// the chunks on the right and bottom edges padded to full size with empty tiles.
+typedef struct {
+  uint8_t index_width;    // Size of an index in bytes, 1, 2 or 4
+  uint8_t chunk_shift;    // Log2 of the chunk side in tiles when TILESHEET_FLAG_CHUNKED is set
+  uint16_t flags;
+  uint32_t palette_size;  // Number of global ids in the palette, palette[0] is always INVALID_GLOBAL_TILE_ID
+} PGETileSheetCompactHeader;
+
+// Tile sheets with TILESHEET_FLAG_ANIM store, right after the palette:
+//   uint16_t num_animations
+//   uint16_t num_frames
+//   PGETileSheetAnimation animations[num_animations]
+//   PGETileSheetFrame frames[num_frames]
+typedef struct {
+  uint32_t palette_index; // Tile placed in the map, drawn as the current frame of its animation
+  uint16_t first_frame;   // First frame of the animation in frames
+  uint16_t num_frames;
+  uint32_t duration_ms;   // Sum of the frame durations
+} PGETileSheetAnimation;
+
+typedef struct {
+  uint32_t palette_index; // Tile drawn during the frame
+  uint32_t duration_ms;
+} PGETileSheetFrame;
+
+// Tile sheets with TILESHEET_FLAG_SOLID store, after the animations, height rows of (width + 7) / 8 bytes.
+// Bit (x & 7) of byte x / 8 of row y is set when tile (x, y) is solid.
+
+// Tile sheets with TILESHEET_FLAG_SPANS store, after the palette, animations and solid mask:
+//   uint32_t num_spans
+//   uint32_t num_indices
+//   uint32_t row_spans[height + 1]   Spans of row y are spans[row_spans[y]] to spans[row_spans[y + 1] - 1]
+//   PGETileSheetSpan spans[num_spans]
+//   indices[num_indices]             Indices of all spans back to back
+typedef struct {
+  uint16_t x;             // First tile of the run
+  uint16_t length;        // Number of non-empty tiles in the run
+  uint32_t first_index;   // Position of the index of the first tile in the packed indices
+} __attribute__((__packed__)) PGETileSheetSpan;
+
+// A chunk slot of the ring. Chunk (x, y) always goes to slot (x % PGE_TILESHEET_CHUNK_RING_SIZE,
+// y % PGE_TILESHEET_CHUNK_RING_SIZE), so any RING_SIZE x RING_SIZE block of chunks can be resident at once.
+typedef struct {
+  int32_t chunk_x;
+  int32_t chunk_y;
+  bool loaded;
+  uint8_t *indices;       // (1 << chunk_shift) * (1 << chunk_shift) indices
+} PGETileSheetChunk;
+
 typedef struct {
   PGETileSheetHeader header;                // Header of the tile sheet data table
   int resource_id;                          // Resource ID of tile sheet data file
   PGESpriteTableHandle sprite_table_handle; // Pointer to corresponding sprite sheet
-  uint32_t *tile_global_ids;                // Pointer to an array of global tile ids
+  uint8_t index_width;                      // Size in bytes of each entry of tile_indices
+  void *tile_indices;                       // Pointer to an array of palette indices, one per tile, NULL when chunked
                                             // Tiles are organized in a 1D array sequentially based on position in a 2D grid
                                             // i.e. Left to right (width number of tiles) and top to bottom (i.e. height number of tiles)
-                                            // tile_global_ids[0] = grid position [0,0]
-                                            // tile_global_ids[width - 1] = grid position [width - 1,0]
-                                            // tile_global_ids[width] = grid position [0,1]
-                                            // tile_global_ids[width + 1] = grid position [1,1]
-                                            // tile_global_ids[width + 2] = grid position [2,1]
-                                            // tile_global_ids[(width * height) - 1] = grid position [width - 1, height - 1]
-
+                                            // tile_indices[0] = grid position [0,0]
+                                            // tile_indices[width - 1] = grid position [width - 1,0]
+                                            // tile_indices[width] = grid position [0,1]
+                                            // tile_indices[width + 1] = grid position [1,1]
+                                            // tile_indices[width + 2] = grid position [2,1]
+                                            // tile_indices[(width * height) - 1] = grid position [width - 1, height - 1]
+  uint32_t palette_size;                    // Number of distinct global ids used by the tile sheet, including the empty tile
+  uint32_t *palette;                        // Global id of each palette index, palette[0] = INVALID_GLOBAL_TILE_ID
+  GBitmap **tile_bitmaps;                   // Bitmaps borrowed from the sprite table for each palette index,
+                                            // acquired on first use and released once out of the streamed tiles
+  uint32_t *tile_stamps;                    // Value of stream_serial when each palette index was last streamed
+  uint32_t stream_serial;                   // Incremented each time the streamed tiles change
+  GRect streamed_tiles;                     // Visible tiles of the last pge_tilesheet_stream
+  GRect viewport;                           // Visible rect in screen coordinates, tiles outside are not drawn
+  uint8_t chunk_shift;                      // Log2 of the chunk side in tiles, 0 when not chunked
+  uint32_t num_chunks_x;                    // Number of chunks across the tile sheet
+  uint32_t chunk_data_offset;               // Resource offset of the first chunk
+  PGETileSheetChunk *chunks;                // Ring of resident chunks, NULL when not chunked
+  uint32_t *row_spans;                      // First span of each row, NULL when not stored as spans
+  PGETileSheetSpan *spans;                  // Runs of non-empty tiles sorted by row then x, tile_indices only
+                                            // holds the indices of these runs
+  uint16_t num_animations;
+  PGETileSheetAnimation *animations;        // Animated tiles, NULL when the tile sheet has none
+  PGETileSheetFrame *anim_frames;           // Frames of all animations
+  uint32_t *display_index;                  // Palette index currently drawn for each palette index
+  uint32_t *anim_serials;                   // Value of anim_serial when the drawn frame of each palette index last changed
+  uint32_t anim_serial;                     // Incremented each time an update changes at least one frame
+  uint32_t anim_clock_ms;                   // Shared clock value of the last update
+  uint8_t *solid_mask;                      // Bit per solid tile, NULL when nothing is solid
 } PGETileSheet;
 
+// Shared animation clock, all tile sheets show the frames of the same point in time
+static uint32_t s_anim_clock_ms = 0;
+
+static uint32_t prv_read_index(void *indices, uint8_t index_width, uint32_t cell) {
+  switch (index_width) {
+    case 1:
+      return ((uint8_t *)indices)[cell];
+    case 2:
+      return ((uint16_t *)indices)[cell];
+    default:
+      return ((uint32_t *)indices)[cell];
+  }
+}
+
+// Make chunk (chunk_x, chunk_y) resident in its ring slot, replacing the chunk that was there
+static PGETileSheetChunk* prv_load_chunk(PGETileSheet *this, int32_t chunk_x, int32_t chunk_y) {
+  PGETileSheetChunk *chunk = &this->chunks[((chunk_y % PGE_TILESHEET_CHUNK_RING_SIZE) * PGE_TILESHEET_CHUNK_RING_SIZE) +
+                                           (chunk_x % PGE_TILESHEET_CHUNK_RING_SIZE)];
+  if (chunk->loaded && (chunk->chunk_x == chunk_x) && (chunk->chunk_y == chunk_y)) {
+    return chunk;
+  }
+
+  size_t size = (1 << (2 * this->chunk_shift)) * this->index_width;
+  size_t offset = this->chunk_data_offset + (((chunk_y * this->num_chunks_x) + chunk_x) * size);
+  chunk->chunk_x = chunk_x;
+  chunk->chunk_y = chunk_y;
+  chunk->loaded = (resource_load_byte_range(resource_get_handle(this->resource_id), offset, chunk->indices, size) == size);
+  PGE_PROFILER_COUNT(PGEProfilerCounterResourceBytes, size);
+  if (!chunk->loaded) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to load tile sheet chunk %ld, %ld", chunk_x, chunk_y);
+    return NULL;
+  }
+  return chunk;
+}
+
+// Find the span of row y containing x, NULL for empty tiles
+static PGETileSheetSpan* prv_find_span(PGETileSheet *this, int32_t x, int32_t y) {
+  uint32_t low = this->row_spans[y];
+  uint32_t high = this->row_spans[y + 1];
+  while (low < high) {
+    uint32_t mid = (low + high) / 2;
+    if (this->spans[mid].x <= x) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+
+  // low is now the first span starting after x
+  if (low == this->row_spans[y]) {
+    return NULL;
+  }
+  PGETileSheetSpan *span = &this->spans[low - 1];
+  return (x < span->x + span->length) ? span : NULL;
+}
+
+// Get the palette index of a tile, coordinates must be within the tile sheet
+static uint32_t prv_get_tile_index(PGETileSheet *this, int32_t x, int32_t y) {
+  if (this->spans) {
+    PGETileSheetSpan *span = prv_find_span(this, x, y);
+    return (span) ? prv_read_index(this->tile_indices, this->index_width, span->first_index + (x - span->x)) : 0;
+  }
+
+  if (!this->chunks) {
+    return prv_read_index(this->tile_indices, this->index_width, (y * this->header.width) + x);
+  }
+
+  // Chunks that were not streamed in ahead of time are loaded on first access
+  PGETileSheetChunk *chunk = prv_load_chunk(this, x >> this->chunk_shift, y >> this->chunk_shift);
+  if (!chunk) {
+    return 0;
+  }
+  uint32_t mask = (1 << this->chunk_shift) - 1;
+  return prv_read_index(chunk->indices, this->index_width, ((y & mask) << this->chunk_shift) + (x & mask));
+}
+
+static void prv_set_tile_index(PGETileSheet *this, uint32_t cell, uint32_t palette_index) {
+  switch (this->index_width) {
+    case 1:
+      ((uint8_t *)this->tile_indices)[cell] = palette_index;
+      break;
+    case 2:
+      ((uint16_t *)this->tile_indices)[cell] = palette_index;
+      break;
+    default:
+      ((uint32_t *)this->tile_indices)[cell] = palette_index;
+      break;
+  }
+}
+
+// Smallest index width able to address every palette entry
+static uint8_t prv_index_width(uint32_t palette_size) {
+  if (palette_size <= 0x100) {
+    return 1;
+  } else if (palette_size <= 0x10000) {
+    return 2;
+  }
+  return 4;
+}
+
+// Find a global id in the palette, entries after palette[0] are sorted ascending
+static uint32_t prv_find_palette_index(PGETileSheet *this, uint32_t tile_global_id) {
+  if (tile_global_id == INVALID_GLOBAL_TILE_ID) {
+    return 0;
+  }
+
+  uint32_t low = 1;
+  uint32_t high = this->palette_size;
+  while (low < high) {
+    uint32_t mid = (low + high) / 2;
+    if (this->palette[mid] < tile_global_id) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+// Add a global id to the sorted palette if it is not already in it
+static bool prv_add_palette_gid(PGETileSheet *this, uint32_t tile_global_id, uint32_t *capacity) {
+  uint32_t index = prv_find_palette_index(this, tile_global_id);
+  if ((index < this->palette_size) && (this->palette[index] == tile_global_id)) {
+    return true;
+  }
+
+  if (this->palette_size == *capacity) {
+    uint32_t *palette = realloc(this->palette, (*capacity * 2) * sizeof(uint32_t));
+    if (!palette) {
+      return false;
+    }
+    this->palette = palette;
+    *capacity *= 2;
+  }
+
+  memmove(&this->palette[index + 1], &this->palette[index], (this->palette_size - index) * sizeof(uint32_t));
+  this->palette[index] = tile_global_id;
+  this->palette_size++;
+  return true;
+}
+
+// Versions 1 and 2 store a uint32_t global id per tile. Convert them to palette indices while reading a
+// chunk at a time, so the full size array is never allocated.
+static bool prv_load_legacy(PGETileSheet *this, ResHandle rh) {
+  uint32_t gids[LEGACY_LOAD_CHUNK];
+  uint32_t num_tiles = this->header.width * this->header.height;
+  size_t offset = sizeof(PGETileSheetHeader);
+
+  // First pass builds the palette
+  uint32_t capacity = 8;
+  this->palette = malloc(capacity * sizeof(uint32_t));
+  if (!this->palette) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to allocate tile sheet palette");
+    return false;
+  }
+  this->palette[0] = INVALID_GLOBAL_TILE_ID;
+  this->palette_size = 1;
+
+  for (uint32_t cell = 0; cell < num_tiles; cell += LEGACY_LOAD_CHUNK) {
+    uint32_t count = ((num_tiles - cell) < LEGACY_LOAD_CHUNK) ? (num_tiles - cell) : LEGACY_LOAD_CHUNK;
+    size_t size = count * sizeof(uint32_t);
+    if (resource_load_byte_range(rh, offset + (cell * sizeof(uint32_t)), (uint8_t*)gids, size) != size) {
+      APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to load tile sheet global ids");
+      return false;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+      if (!prv_add_palette_gid(this, gids[i], &capacity)) {
+        APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to allocate tile sheet palette");
+        return false;
+      }
+    }
+  }
+
+  // Second pass maps every tile to its palette index
+  this->index_width = prv_index_width(this->palette_size);
+  this->tile_indices = malloc(num_tiles * this->index_width);
+  if (!this->tile_indices) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to allocate array for tile sheet indices");
+    return false;
+  }
+
+  for (uint32_t cell = 0; cell < num_tiles; cell += LEGACY_LOAD_CHUNK) {
+    uint32_t count = ((num_tiles - cell) < LEGACY_LOAD_CHUNK) ? (num_tiles - cell) : LEGACY_LOAD_CHUNK;
+    size_t size = count * sizeof(uint32_t);
+    if (resource_load_byte_range(rh, offset + (cell * sizeof(uint32_t)), (uint8_t*)gids, size) != size) {
+      APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to load tile sheet global ids");
+      return false;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+      prv_set_tile_index(this, cell + i, prv_find_palette_index(this, gids[i]));
+    }
+  }
+  return true;
+}
+
+// Chunked tile sheets only allocate the ring, chunks are loaded as the visible area moves
+static bool prv_create_chunks(PGETileSheet *this, uint8_t chunk_shift, uint32_t offset) {
+  if ((chunk_shift == 0) || (chunk_shift > 7)) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Invalid tile sheet chunk size %d", chunk_shift);
+    return false;
+  }
+
+  this->chunk_shift = chunk_shift;
+  this->num_chunks_x = (this->header.width + (1 << chunk_shift) - 1) >> chunk_shift;
+  this->chunk_data_offset = offset;
+
+  uint32_t num_slots = PGE_TILESHEET_CHUNK_RING_SIZE * PGE_TILESHEET_CHUNK_RING_SIZE;
+  size_t chunk_size = (1 << (2 * chunk_shift)) * this->index_width;
+  this->chunks = calloc(num_slots, sizeof(PGETileSheetChunk));
+  this->tile_indices = malloc(num_slots * chunk_size); // Backing store of all slots
+  if ((!this->chunks) || (!this->tile_indices)) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to allocate tile sheet chunks");
+    return false;
+  }
+  for (uint32_t i = 0; i < num_slots; i++) {
+    this->chunks[i].indices = &((uint8_t *)this->tile_indices)[i * chunk_size];
+  }
+  return true;
+}
+
+// Load the span table and the packed indices of the non-empty tiles
+static bool prv_load_spans(PGETileSheet *this, ResHandle rh, uint32_t offset) {
+  uint32_t counts[2];
+  if (resource_load_byte_range(rh, offset, (uint8_t*)counts, sizeof(counts)) != sizeof(counts)) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to load tile sheet spans");
+    return false;
+  }
+  offset += sizeof(counts);
+
+  size_t rows_size = (this->header.height + 1) * sizeof(uint32_t);
+  size_t spans_size = counts[0] * sizeof(PGETileSheetSpan);
+  size_t indices_size = counts[1] * this->index_width;
+  this->row_spans = malloc(rows_size);
+  this->spans = malloc(spans_size ? spans_size : 1);
+  this->tile_indices = malloc(indices_size ? indices_size : 1);
+  if ((!this->row_spans) || (!this->spans) || (!this->tile_indices)) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to allocate tile sheet spans");
+    return false;
+  }
+
+  if ((resource_load_byte_range(rh, offset, (uint8_t*)this->row_spans, rows_size) != rows_size) ||
+      (resource_load_byte_range(rh, offset + rows_size, (uint8_t*)this->spans, spans_size) != spans_size) ||
+      (resource_load_byte_range(rh, offset + rows_size + spans_size, (uint8_t*)this->tile_indices, indices_size) != indices_size)) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to load tile sheet spans");
+    return false;
+  }
+  return true;
+}
+
+// Load the animation sequences, every palette index starts out drawn as itself
+static bool prv_load_animations(PGETileSheet *this, ResHandle rh, uint32_t *offset) {
+  uint16_t counts[2];
+  if (resource_load_byte_range(rh, *offset, (uint8_t*)counts, sizeof(counts)) != sizeof(counts)) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to load tile sheet animations");
+    return false;
+  }
+  *offset += sizeof(counts);
+
+  size_t animations_size = counts[0] * sizeof(PGETileSheetAnimation);
+  size_t frames_size = counts[1] * sizeof(PGETileSheetFrame);
+  this->num_animations = counts[0];
+  this->animations = malloc(animations_size);
+  this->anim_frames = malloc(frames_size);
+  this->display_index = malloc(this->palette_size * sizeof(uint32_t));
+  this->anim_serials = calloc(this->palette_size, sizeof(uint32_t));
+  if ((!this->animations) || (!this->anim_frames) || (!this->display_index) || (!this->anim_serials)) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to allocate tile sheet animations");
+    return false;
+  }
+
+  if ((resource_load_byte_range(rh, *offset, (uint8_t*)this->animations, animations_size) != animations_size) ||
+      (resource_load_byte_range(rh, *offset + animations_size, (uint8_t*)this->anim_frames, frames_size) != frames_size)) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to load tile sheet animations");
+    return false;
+  }
+  *offset += animations_size + frames_size;
+
+  for (uint32_t i = 0; i < this->num_animations; i++) {
+    PGETileSheetAnimation *animation = &this->animations[i];
+    if ((animation->palette_index >= this->palette_size) || (animation->num_frames == 0) ||
+        (animation->first_frame + animation->num_frames > counts[1])) {
+      APP_LOG(APP_LOG_LEVEL_ERROR, "Invalid tile sheet animation %ld", i);
+      return false;
+    }
+    for (uint32_t j = 0; j < animation->num_frames; j++) {
+      if (this->anim_frames[animation->first_frame + j].palette_index >= this->palette_size) {
+        APP_LOG(APP_LOG_LEVEL_ERROR, "Invalid tile sheet animation %ld", i);
+        return false;
+      }
+    }
+  }
+
+  for (uint32_t i = 0; i < this->palette_size; i++) {
+    this->display_index[i] = i;
+  }
+  this->anim_clock_ms = ~(0); // Force the first update
+  return true;
+}
+
+static bool prv_load_solid_mask(PGETileSheet *this, ResHandle rh, uint32_t *offset) {
+  size_t size = ((this->header.width + 7) / 8) * this->header.height;
+  this->solid_mask = malloc(size);
+  if (!this->solid_mask) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to allocate tile sheet solid mask");
+    return false;
+  }
+  if (resource_load_byte_range(rh, *offset, this->solid_mask, size) != size) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to load tile sheet solid mask");
+    return false;
+  }
+  *offset += size;
+  return true;
+}
+
+// Version 3 stores the palette and the indices directly
+static bool prv_load_compact(PGETileSheet *this, ResHandle rh) {
+  PGETileSheetCompactHeader compact_header;
+  uint32_t offset = sizeof(PGETileSheetHeader);
+  if (resource_load_byte_range(rh, offset, (uint8_t*)&compact_header, sizeof(compact_header)) != sizeof(compact_header)) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to load tile sheet header");
+    return false;
+  }
+  offset += sizeof(compact_header);
+
+  if ((compact_header.palette_size == 0) ||
+      ((compact_header.index_width != 1) && (compact_header.index_width != 2) && (compact_header.index_width != 4))) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Invalid tile sheet index width %d", compact_header.index_width);
+    return false;
+  }
+
+  this->palette_size = compact_header.palette_size;
+  size_t size = this->palette_size * sizeof(uint32_t);
+  this->palette = malloc(size);
+  if (!this->palette) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to allocate tile sheet palette");
+    return false;
+  }
+  if (resource_load_byte_range(rh, offset, (uint8_t*)this->palette, size) != size) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to load tile sheet palette");
+    return false;
+  }
+  offset += size;
+
+  this->index_width = compact_header.index_width;
+  if ((compact_header.flags & TILESHEET_FLAG_ANIM) && (!prv_load_animations(this, rh, &offset))) {
+    return false;
+  }
+  if ((compact_header.flags & TILESHEET_FLAG_SOLID) && (!prv_load_solid_mask(this, rh, &offset))) {
+    return false;
+  }
+
+  if (compact_header.flags & TILESHEET_FLAG_SPANS) {
+    return prv_load_spans(this, rh, offset);
+  } else if (compact_header.flags & TILESHEET_FLAG_CHUNKED) {
+    return prv_create_chunks(this, compact_header.chunk_shift, offset);
+  }
+
+  size = this->header.width * this->header.height * this->index_width;
+  this->tile_indices = malloc(size);
+  if (!this->tile_indices) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to allocate array for tile sheet indices");
+    return false;
+  }
+  if (resource_load_byte_range(rh, offset, (uint8_t*)this->tile_indices, size) != size) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to load tile sheet indices");
+    return false;
+  }
+  return true;
+}
+
+static void prv_free_tilesheet(PGETileSheet *this) {
+  if (this->tile_bitmaps) {
+    for (uint32_t i = 0; i < this->palette_size; i++) {
+      if (this->tile_bitmaps[i]) {
+        pge_bitmap_cache_release(this->tile_bitmaps[i]);
+      }
+    }
+    free(this->tile_bitmaps);
+  }
+  if (this->tile_stamps) {
+    free(this->tile_stamps);
+  }
+  if (this->palette) {
+    free(this->palette);
+  }
+  if (this->tile_indices) {
+    free(this->tile_indices);
+  }
+  if (this->chunks) {
+    free(this->chunks);
+  }
+  if (this->row_spans) {
+    free(this->row_spans);
+  }
+  if (this->spans) {
+    free(this->spans);
+  }
+  if (this->animations) {
+    free(this->animations);
+  }
+  if (this->anim_frames) {
+    free(this->anim_frames);
+  }
+  if (this->display_index) {
+    free(this->display_index);
+  }
+  if (this->anim_serials) {
+    free(this->anim_serials);
+  }
+  if (this->solid_mask) {
+    free(this->solid_mask);
+  }
+  free(this);
+}
+
+// Get the bitmap of a palette index, loading it from the sprite table the first time it is drawn
+static GBitmap* prv_get_tile_bitmap(PGETileSheet *this, uint32_t palette_index) {
+  if ((palette_index == 0) || (palette_index >= this->palette_size)) {
+    return NULL;
+  }
+
+  // Animated tiles are drawn as their current frame
+  if (this->display_index) {
+    palette_index = this->display_index[palette_index];
+  }
+
+  if (!this->tile_bitmaps[palette_index]) {
+    this->tile_bitmaps[palette_index] = pge_spritesheet_acquire_bitmap_gid(this->sprite_table_handle, this->palette[palette_index]);
+  }
+  return this->tile_bitmaps[palette_index];
+}
+
+// The ring only keeps up with the viewport if the visible tiles plus the prefetch margin span at most
+// PGE_TILESHEET_CHUNK_RING_SIZE chunks whatever their alignment, chunks are reloaded on nearly every tile lookup
+// otherwise. The tile size is taken from the first tile of the palette.
+static void prv_check_chunk_span(PGETileSheet *this) {
+  GBitmap *bitmap = prv_get_tile_bitmap(this, 1);
+  if (!bitmap) {
+    return;
+  }
+
+  GRect bounds = gbitmap_get_bounds(bitmap);
+  if ((bounds.size.w <= 0) || (bounds.size.h <= 0)) {
+    return;
+  }
+  int32_t span_x = ((this->viewport.size.w + bounds.size.w - 1) / bounds.size.w) + 1 + (2 * PGE_TILESHEET_CHUNK_PREFETCH);
+  int32_t span_y = ((this->viewport.size.h + bounds.size.h - 1) / bounds.size.h) + 1 + (2 * PGE_TILESHEET_CHUNK_PREFETCH);
+  int32_t span = (span_x > span_y) ? span_x : span_y;
+  if (span - 1 > (1 << this->chunk_shift) * (PGE_TILESHEET_CHUNK_RING_SIZE - 1)) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Tile sheet chunks of %d tiles are too small for %ld tiles of %dx%d pixels",
+            1 << this->chunk_shift, span, bounds.size.w, bounds.size.h);
+  }
+}
+
 PGETileSheetHandle pge_tilesheet_create(int resource_id, PGESpriteTableHandle sprite_table_handle) {
   PGETileSheetHandle handle = 0;
   PGETileSheet *this = calloc(1, sizeof(PGETileSheet));
@@ -41,29 +580,31 @@ PGETileSheetHandle pge_tilesheet_create(int resource_id, PGESpriteTableHandle sp
     goto cleanup;
   }
 
-  uint32_t size_of_global_ids = this->header.filesize - sizeof(PGETileSheetHeader);
-  this->tile_global_ids = malloc(size_of_global_ids);
-  if (!this->tile_global_ids) {
-    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to allocate array for tile sheet global ids");
+  bool loaded = (this->header.version >= TILESHEET_VERSION_COMPACT) ? prv_load_compact(this, rh) : prv_load_legacy(this, rh);
+  if (!loaded) {
     goto cleanup;
   }
 
-  if (resource_load_byte_range(rh, sizeof(PGETileSheetHeader), (uint8_t*)&this->tile_global_ids[0], size_of_global_ids) != size_of_global_ids) {
-    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to load tile sheet global ids");
+  // One cached bitmap per palette entry
+  this->tile_bitmaps = calloc(this->palette_size, sizeof(GBitmap *));
+  this->tile_stamps = calloc(this->palette_size, sizeof(uint32_t));
+  if (!this->tile_bitmaps || !this->tile_stamps) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to allocate tile bitmap cache");
     goto cleanup;
   }
 
   this->resource_id = resource_id;
   this->sprite_table_handle = sprite_table_handle;
-  handle = (uint32_t) this;
+  this->viewport = PGE_TILESHEET_DEFAULT_VIEWPORT;
+  if (this->chunks) {
+    prv_check_chunk_span(this);
+  }
+  handle = (uintptr_t) this;
   goto done;
 
 cleanup:
   if (this) {
-    if (this->tile_global_ids) {
-      free(this->tile_global_ids);
-    }
-    free(this);
+    prv_free_tilesheet(this);
   }
 
 done:
@@ -73,63 +614,424 @@ done:
 void pge_tilesheet_destroy(PGETileSheetHandle handle) {
   PGETileSheet *this = (PGETileSheet *)handle;
   if (this) {
-    if (this->tile_global_ids) {
-      free(this->tile_global_ids);
-    }
-    free(this);
+    prv_free_tilesheet(this);
+  }
+}
+
+// Draw the tile of a palette index, returns false if nothing was drawn
+static bool prv_draw_palette_index(GContext *ctx, PGETileSheet *this, uint32_t palette_index, GPoint position) {
+  if (palette_index == 0) {
+    return false;
+  }
+
+  GBitmap *bitmap = prv_get_tile_bitmap(this, palette_index);
+  if (!bitmap) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to load bitmap with global id %ld", this->palette[palette_index]);
+    return false;
   }
+
+  GRect bounds = gbitmap_get_bounds(bitmap);
+  graphics_draw_bitmap_in_rect(ctx, bitmap, GRect(position.x, position.y, bounds.size.w, bounds.size.h));
+  PGE_PROFILER_COUNT(PGEProfilerCounterTilesDrawn, 1);
+  return true;
+}
+
+// Draw a tile, returns false if nothing was drawn
+static bool prv_draw_tile(GContext *ctx, PGETileSheet *this, GPoint coordinate, GPoint position) {
+  if ((coordinate.x < 0) || (coordinate.y < 0) ||
+      (coordinate.x >= (int32_t)this->header.width) || (coordinate.y >= (int32_t)this->header.height)) {
+    return false;
+  }
+
+  // Get palette index for the tile to draw
+  return prv_draw_palette_index(ctx, this, prv_get_tile_index(this, coordinate.x, coordinate.y), position);
 }
 
-static PGESprite *s_tile_sprite = NULL;
-static PGETileSheetHandle prev_tile_handle = 0;
-static uint32_t prev_tile_global_id = 0;
 void pge_tilesheet_draw_tile(GContext *ctx, PGETileSheetHandle handle, GPoint coordinate, GPoint position) {
   if (!handle) {
     return;
   }
-  PGETileSheet *this = (PGETileSheet *)handle;
-  // Get global ID for the tile to draw
-  uint32_t index = (coordinate.y * this->header.width) + coordinate.x;
-  if (this->tile_global_ids[index] == INVALID_GLOBAL_TILE_ID) {
+
+  // Tiles starting past the right or bottom of the camera view cannot be visible
+  GRect view = pge_camera_get_view();
+  position = pge_camera_world_to_screen(position);
+  if ((position.x >= view.origin.x + view.size.w) || (position.y >= view.origin.y + view.size.h)) {
     return;
   }
+  prv_draw_tile(ctx, (PGETileSheet *)handle, coordinate, position);
+}
 
-  if ((s_tile_sprite == NULL) || (prev_tile_handle != handle) || (this->tile_global_ids[index] != prev_tile_global_id)) {
-    if (s_tile_sprite) {
-      pge_sprite_destroy(s_tile_sprite);
-    }
+// Narrow the tile range [*first, *end) along one axis to the tiles of size step, the first one drawn at
+// origin, that overlap the visible span [visible_start, visible_start + visible_size)
+static void prv_clip_range(int32_t origin, int32_t step, int32_t visible_start, int32_t visible_size,
+                           int32_t box_start, int32_t *first, int32_t *end) {
+  if (step <= 0) {
+    return;
+  }
 
-    // Create a temporary sprite to draw
-    s_tile_sprite = pge_spritesheet_create_sprite_gid(this->sprite_table_handle, this->tile_global_ids[index], position);
+  // Tile n covers [origin + n * step, origin + (n + 1) * step)
+  int32_t offset = visible_start - origin;
+  int32_t first_visible = (offset >= 0) ? (offset / step) : -((step - 1 - offset) / step);
+  offset = visible_start + visible_size - origin;
+  int32_t end_visible = (offset > 0) ? ((offset + step - 1) / step) : -((-offset) / step);
 
-    prev_tile_handle = handle;
-    prev_tile_global_id = this->tile_global_ids[index];
-  } else {
-    pge_sprite_set_position(s_tile_sprite, position);
+  if (*first < box_start + first_visible) {
+    *first = box_start + first_visible;
   }
- 
-  if (!s_tile_sprite) {
-    APP_LOG(APP_LOG_LEVEL_ERROR, "Unable to create sprite with global id %ld at index %ld", this->tile_global_ids[index], index);
-    return;
+  if (*end > box_start + end_visible) {
+    *end = box_start + end_visible;
   }
-
-  // Draw and then destroy the sprite
-  pge_sprite_draw(s_tile_sprite, ctx);
 }
 
-void pge_tilesheet_draw_grid(GContext *ctx, PGETileSheetHandle handle, GRect box, GPoint position, GSize spacing) {
+uint32_t pge_tilesheet_draw_grid(GContext *ctx, PGETileSheetHandle handle, GRect box, GPoint position, GSize spacing) {
   if (!handle) {
-    return;
+    return 0;
+  }
+  PGETileSheet *this = (PGETileSheet *)handle;
+
+  // Intersect the box with the map bounds
+  int32_t first_x = (box.origin.x > 0) ? box.origin.x : 0;
+  int32_t first_y = (box.origin.y > 0) ? box.origin.y : 0;
+  int32_t end_x = box.origin.x + box.size.w;
+  int32_t end_y = box.origin.y + box.size.h;
+  if (end_x > (int32_t)this->header.width) {
+    end_x = this->header.width;
+  }
+  if (end_y > (int32_t)this->header.height) {
+    end_y = this->header.height;
   }
-  for (uint16_t y = box.origin.y; y < box.origin.y + box.size.h; y++) {
-    for (uint16_t x = box.origin.x; x < box.origin.x + box.size.w; x++) {
+
+  // Skip rows and columns that are entirely outside of the viewport or the camera view
+  GRect view = pge_camera_get_view();
+  position = pge_camera_world_to_screen(position);
+  prv_clip_range(position.x, spacing.w, this->viewport.origin.x, this->viewport.size.w, box.origin.x, &first_x, &end_x);
+  prv_clip_range(position.y, spacing.h, this->viewport.origin.y, this->viewport.size.h, box.origin.y, &first_y, &end_y);
+  prv_clip_range(position.x, spacing.w, view.origin.x, view.size.w, box.origin.x, &first_x, &end_x);
+  prv_clip_range(position.y, spacing.h, view.origin.y, view.size.h, box.origin.y, &first_y, &end_y);
+  if ((first_x < end_x) && (first_y < end_y)) {
+    pge_tilesheet_stream(handle, GRect(first_x, first_y, end_x - first_x, end_y - first_y));
+  }
+  pge_tilesheet_update_animations(handle);
+
+  uint32_t num_drawn = 0;
+  if (this->spans) {
+    // Only visit the runs of non-empty tiles overlapping the visible columns
+    for (int32_t y = first_y; y < end_y; y++) {
+      for (uint32_t i = this->row_spans[y]; i < this->row_spans[y + 1]; i++) {
+        PGETileSheetSpan *span = &this->spans[i];
+        int32_t span_first = (span->x > first_x) ? span->x : first_x;
+        int32_t span_end = (span->x + span->length < end_x) ? span->x + span->length : end_x;
+        for (int32_t x = span_first; x < span_end; x++) {
+          GPoint draw_position = position;
+          draw_position.x += (x - box.origin.x) * spacing.w;
+          draw_position.y += (y - box.origin.y) * spacing.h;
+          uint32_t palette_index = prv_read_index(this->tile_indices, this->index_width, span->first_index + (x - span->x));
+          if (prv_draw_palette_index(ctx, this, palette_index, draw_position)) {
+            num_drawn++;
+          }
+        }
+      }
+    }
+    return num_drawn;
+  }
+
+  for (int32_t y = first_y; y < end_y; y++) {
+    for (int32_t x = first_x; x < end_x; x++) {
       GPoint coordinate = GPoint(x, y);
       GPoint draw_position = position;
       draw_position.x += (x - box.origin.x) * spacing.w;
       draw_position.y += (y - box.origin.y) * spacing.h;
-      pge_tilesheet_draw_tile(ctx, handle, coordinate, draw_position);
+      if (prv_draw_tile(ctx, this, coordinate, draw_position)) {
+        num_drawn++;
+      }
+    }
+  }
+  return num_drawn;
+}
+
+void pge_tilesheet_set_viewport(PGETileSheetHandle handle, GRect viewport) {
+  if (!handle) {
+    return;
+  }
+  PGETileSheet *this = (PGETileSheet *)handle;
+  this->viewport = viewport;
+}
+
+GRect pge_tilesheet_get_viewport(PGETileSheetHandle handle) {
+  if (!handle) {
+    return GRectZero;
+  }
+  PGETileSheet *this = (PGETileSheet *)handle;
+  return this->viewport;
+}
+
+// Release the borrowed bitmaps of palette indices that are not among the visible tiles, so the bitmap cache can
+// evict the tiles that scrolled away instead of keeping every tile ever drawn pinned
+static void prv_release_hidden_bitmaps(PGETileSheet *this, GRect visible_tiles) {
+  int32_t first_x = (visible_tiles.origin.x > 0) ? visible_tiles.origin.x : 0;
+  int32_t first_y = (visible_tiles.origin.y > 0) ? visible_tiles.origin.y : 0;
+  int32_t end_x = visible_tiles.origin.x + visible_tiles.size.w;
+  int32_t end_y = visible_tiles.origin.y + visible_tiles.size.h;
+  end_x = (end_x < (int32_t)this->header.width) ? end_x : (int32_t)this->header.width;
+  end_y = (end_y < (int32_t)this->header.height) ? end_y : (int32_t)this->header.height;
+
+  this->stream_serial++;
+  for (int32_t y = first_y; y < end_y; y++) {
+    for (int32_t x = first_x; x < end_x; x++) {
+      uint32_t palette_index = prv_get_tile_index(this, x, y);
+      this->tile_stamps[palette_index] = this->stream_serial;
+      // Animated tiles are drawn with the bitmap of their current frame
+      if (this->display_index) {
+        this->tile_stamps[this->display_index[palette_index]] = this->stream_serial;
+      }
+    }
+  }
+
+  for (uint32_t i = 1; i < this->palette_size; i++) {
+    if (this->tile_bitmaps[i] && (this->tile_stamps[i] != this->stream_serial)) {
+      pge_bitmap_cache_release(this->tile_bitmaps[i]);
+      this->tile_bitmaps[i] = NULL;
+    }
+  }
+}
+
+void pge_tilesheet_stream(PGETileSheetHandle handle, GRect visible_tiles) {
+  if (!handle) {
+    return;
+  }
+  PGETileSheet *this = (PGETileSheet *)handle;
+
+  if (this->chunks) {
+    // Load the chunks within PGE_TILESHEET_CHUNK_PREFETCH tiles of the visible tiles
+    int32_t first_x = visible_tiles.origin.x - PGE_TILESHEET_CHUNK_PREFETCH;
+    int32_t first_y = visible_tiles.origin.y - PGE_TILESHEET_CHUNK_PREFETCH;
+    int32_t last_x = visible_tiles.origin.x + visible_tiles.size.w - 1 + PGE_TILESHEET_CHUNK_PREFETCH;
+    int32_t last_y = visible_tiles.origin.y + visible_tiles.size.h - 1 + PGE_TILESHEET_CHUNK_PREFETCH;
+    first_x = (first_x > 0) ? first_x : 0;
+    first_y = (first_y > 0) ? first_y : 0;
+    last_x = (last_x < (int32_t)this->header.width) ? last_x : (int32_t)this->header.width - 1;
+    last_y = (last_y < (int32_t)this->header.height) ? last_y : (int32_t)this->header.height - 1;
+
+    for (int32_t chunk_y = first_y >> this->chunk_shift; chunk_y <= (last_y >> this->chunk_shift); chunk_y++) {
+      for (int32_t chunk_x = first_x >> this->chunk_shift; chunk_x <= (last_x >> this->chunk_shift); chunk_x++) {
+        prv_load_chunk(this, chunk_x, chunk_y);
+      }
+    }
+  }
+
+  if (!grect_equal(&visible_tiles, &this->streamed_tiles)) {
+    this->streamed_tiles = visible_tiles;
+    prv_release_hidden_bitmaps(this, visible_tiles);
+  }
+}
+
+void pge_tilesheet_set_anim_clock(uint32_t time_ms) {
+  s_anim_clock_ms = time_ms;
+}
+
+void pge_tilesheet_advance_anim_clock(uint32_t elapsed_ms) {
+  s_anim_clock_ms += elapsed_ms;
+}
+
+uint32_t pge_tilesheet_update_animations(PGETileSheetHandle handle) {
+  if (!handle) {
+    return 0;
+  }
+  PGETileSheet *this = (PGETileSheet *)handle;
+  if ((!this->animations) || (this->anim_clock_ms == s_anim_clock_ms)) {
+    return this->anim_serial;
+  }
+  this->anim_clock_ms = s_anim_clock_ms;
+
+  bool changed = false;
+  for (uint32_t i = 0; i < this->num_animations; i++) {
+    PGETileSheetAnimation *animation = &this->animations[i];
+    if (animation->duration_ms == 0) {
+      continue;
+    }
+
+    // Find the frame shown at this point of the loop
+    uint32_t time_ms = s_anim_clock_ms % animation->duration_ms;
+    PGETileSheetFrame *frame = &this->anim_frames[animation->first_frame];
+    for (uint32_t j = 0; (j < animation->num_frames - 1u) && (time_ms >= frame->duration_ms); j++) {
+      time_ms -= frame->duration_ms;
+      frame++;
+    }
+
+    if (this->display_index[animation->palette_index] != frame->palette_index) {
+      if (!changed) {
+        this->anim_serial++;
+        changed = true;
+      }
+      this->display_index[animation->palette_index] = frame->palette_index;
+      this->anim_serials[animation->palette_index] = this->anim_serial;
+    }
+  }
+  return this->anim_serial;
+}
+
+uint32_t pge_tilesheet_get_tile_anim_serial(PGETileSheetHandle handle, GPoint coordinate) {
+  if (!handle) {
+    return 0;
+  }
+  PGETileSheet *this = (PGETileSheet *)handle;
+  if ((!this->anim_serials) || (coordinate.x < 0) || (coordinate.y < 0) ||
+      (coordinate.x >= (int32_t)this->header.width) || (coordinate.y >= (int32_t)this->header.height)) {
+    return 0;
+  }
+  return this->anim_serials[prv_get_tile_index(this, coordinate.x, coordinate.y)];
+}
+
+// Tiles outside of the tile sheet are not solid
+static bool prv_is_solid(PGETileSheet *this, int32_t x, int32_t y) {
+  if ((x < 0) || (y < 0) || (x >= (int32_t)this->header.width) || (y >= (int32_t)this->header.height)) {
+    return false;
+  }
+  return (this->solid_mask[(y * ((this->header.width + 7) / 8)) + (x >> 3)] >> (x & 7)) & 0x1;
+}
+
+// Whether any tile of column x in rows [first_y, last_y] is solid
+static bool prv_is_column_solid(PGETileSheet *this, int32_t x, int32_t first_y, int32_t last_y) {
+  for (int32_t y = first_y; y <= last_y; y++) {
+    if (prv_is_solid(this, x, y)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Whether any tile of row y in columns [first_x, last_x] is solid
+static bool prv_is_row_solid(PGETileSheet *this, int32_t y, int32_t first_x, int32_t last_x) {
+  for (int32_t x = first_x; x <= last_x; x++) {
+    if (prv_is_solid(this, x, y)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static int32_t prv_tile_floor(int32_t value, int32_t tile_size) {
+  return (value >= 0) ? (value / tile_size) : -((tile_size - 1 - value) / tile_size);
+}
+
+bool pge_tilesheet_is_solid(PGETileSheetHandle handle, GPoint coordinate) {
+  if (!handle) {
+    return false;
+  }
+  PGETileSheet *this = (PGETileSheet *)handle;
+  return (this->solid_mask) ? prv_is_solid(this, coordinate.x, coordinate.y) : false;
+}
+
+uint32_t pge_tilesheet_get_solid_tiles(PGETileSheetHandle handle, GRect rect, GSize tile_size, GPoint *tiles, uint32_t max_tiles) {
+  if ((!handle) || (tile_size.w <= 0) || (tile_size.h <= 0) || (rect.size.w <= 0) || (rect.size.h <= 0)) {
+    return 0;
+  }
+  PGETileSheet *this = (PGETileSheet *)handle;
+  if (!this->solid_mask) {
+    return 0;
+  }
+
+  // Only the cells covered by the rect are visited
+  int32_t first_x = prv_tile_floor(rect.origin.x, tile_size.w);
+  int32_t first_y = prv_tile_floor(rect.origin.y, tile_size.h);
+  int32_t last_x = prv_tile_floor(rect.origin.x + rect.size.w - 1, tile_size.w);
+  int32_t last_y = prv_tile_floor(rect.origin.y + rect.size.h - 1, tile_size.h);
+  uint32_t num_solid = 0;
+  for (int32_t y = first_y; y <= last_y; y++) {
+    for (int32_t x = first_x; x <= last_x; x++) {
+      if (prv_is_solid(this, x, y)) {
+        if (tiles && (num_solid < max_tiles)) {
+          tiles[num_solid] = GPoint(x, y);
+        }
+        num_solid++;
+      }
+    }
+  }
+  return num_solid;
+}
+
+int16_t pge_tilesheet_sweep_x(PGETileSheetHandle handle, GRect rect, GSize tile_size, int16_t dx) {
+  if ((!handle) || (tile_size.w <= 0) || (tile_size.h <= 0) || (rect.size.w <= 0) || (rect.size.h <= 0) || (dx == 0)) {
+    return dx;
+  }
+  PGETileSheet *this = (PGETileSheet *)handle;
+  if (!this->solid_mask) {
+    return dx;
+  }
+
+  // Walk the columns entered by the leading edge, nearest first
+  int32_t first_y = prv_tile_floor(rect.origin.y, tile_size.h);
+  int32_t last_y = prv_tile_floor(rect.origin.y + rect.size.h - 1, tile_size.h);
+  if (dx > 0) {
+    int32_t edge = rect.origin.x + rect.size.w;
+    for (int32_t x = prv_tile_floor(edge, tile_size.w); x <= prv_tile_floor(edge + dx - 1, tile_size.w); x++) {
+      if (prv_is_column_solid(this, x, first_y, last_y)) {
+        int32_t allowed = (x * tile_size.w) - edge;
+        return (allowed > 0) ? allowed : 0;
+      }
+    }
+  } else {
+    int32_t edge = rect.origin.x;
+    for (int32_t x = prv_tile_floor(edge - 1, tile_size.w); x >= prv_tile_floor(edge + dx, tile_size.w); x--) {
+      if (prv_is_column_solid(this, x, first_y, last_y)) {
+        int32_t allowed = ((x + 1) * tile_size.w) - edge;
+        return (allowed < 0) ? allowed : 0;
+      }
+    }
+  }
+  return dx;
+}
+
+int16_t pge_tilesheet_sweep_y(PGETileSheetHandle handle, GRect rect, GSize tile_size, int16_t dy) {
+  if ((!handle) || (tile_size.w <= 0) || (tile_size.h <= 0) || (rect.size.w <= 0) || (rect.size.h <= 0) || (dy == 0)) {
+    return dy;
+  }
+  PGETileSheet *this = (PGETileSheet *)handle;
+  if (!this->solid_mask) {
+    return dy;
+  }
+
+  // Walk the rows entered by the leading edge, nearest first
+  int32_t first_x = prv_tile_floor(rect.origin.x, tile_size.w);
+  int32_t last_x = prv_tile_floor(rect.origin.x + rect.size.w - 1, tile_size.w);
+  if (dy > 0) {
+    int32_t edge = rect.origin.y + rect.size.h;
+    for (int32_t y = prv_tile_floor(edge, tile_size.h); y <= prv_tile_floor(edge + dy - 1, tile_size.h); y++) {
+      if (prv_is_row_solid(this, y, first_x, last_x)) {
+        int32_t allowed = (y * tile_size.h) - edge;
+        return (allowed > 0) ? allowed : 0;
+      }
+    }
+  } else {
+    int32_t edge = rect.origin.y;
+    for (int32_t y = prv_tile_floor(edge - 1, tile_size.h); y >= prv_tile_floor(edge + dy, tile_size.h); y--) {
+      if (prv_is_row_solid(this, y, first_x, last_x)) {
+        int32_t allowed = ((y + 1) * tile_size.h) - edge;
+        return (allowed < 0) ? allowed : 0;
+      }
     }
   }
+  return dy;
+}
+
+GPoint pge_tilesheet_sweep(PGETileSheetHandle handle, GRect rect, GSize tile_size, int16_t dx, int16_t dy) {
+  // Move along x first, then along y from the new position
+  int16_t allowed_dx = pge_tilesheet_sweep_x(handle, rect, tile_size, dx);
+  rect.origin.x += allowed_dx;
+  return GPoint(allowed_dx, pge_tilesheet_sweep_y(handle, rect, tile_size, dy));
+}
+
+GBitmap* pge_tilesheet_get_tile_bitmap(PGETileSheetHandle handle, GPoint coordinate) {
+  if (!handle) {
+    return NULL;
+  }
+  PGETileSheet *this = (PGETileSheet *)handle;
+  if ((coordinate.x < 0) || (coordinate.y < 0) ||
+      (coordinate.x >= (int32_t)this->header.width) || (coordinate.y >= (int32_t)this->header.height)) {
+    return NULL;
+  }
+
+  return prv_get_tile_bitmap(this, prv_get_tile_index(this, coordinate.x, coordinate.y));
 }
 
 GSize pge_tilesheet_get_tilesheet_size(PGETileSheetHandle handle) {
@@ -4,16 +4,88 @@
 #include "pge_sprite.h"
 #include "pge_spritesheet.h"
 
-typedef uint32_t PGETileSheetHandle;
+typedef uintptr_t PGETileSheetHandle;
+
+#define PGE_TILESHEET_DEFAULT_VIEWPORT GRect(0, 0, 144, 168)
+
+// Chunked tile sheets keep a ring of PGE_TILESHEET_CHUNK_RING_SIZE x PGE_TILESHEET_CHUNK_RING_SIZE chunks
+// resident and load the chunks within PGE_TILESHEET_CHUNK_PREFETCH tiles of the visible tiles ahead of time.
+// The visible tiles plus the prefetch margin must span no more than PGE_TILESHEET_CHUNK_RING_SIZE chunks
+// in each direction, or chunks will be reloaded every frame. spritesheetgen.py rejects smaller chunk sizes and
+// pge_tilesheet_create logs an error for them.
+#ifndef PGE_TILESHEET_CHUNK_RING_SIZE
+#define PGE_TILESHEET_CHUNK_RING_SIZE 3
+#endif
+#ifndef PGE_TILESHEET_CHUNK_PREFETCH
+#define PGE_TILESHEET_CHUNK_PREFETCH 4
+#endif
 
 PGETileSheetHandle pge_tilesheet_create(int resource_id, PGESpriteTableHandle sprite_table_handle);
 
 void pge_tilesheet_destroy(PGETileSheetHandle handle);
 
+// Draws the tile at coordinate (in tiles) at position (in world pixels, converted by the camera)
 void pge_tilesheet_draw_tile(GContext *ctx, PGETileSheetHandle handle, GPoint coordinate, GPoint position);
 
-void pge_tilesheet_draw_grid(GContext *ctx, PGETileSheetHandle handle, GRect box, GPoint position, GSize spacing);
+// Draws the tiles of box (in tiles) with the top left tile at position (in world pixels, converted by the camera)
+// and spacing pixels between tiles. The box is clipped to the tile sheet bounds and rows or columns entirely
+// outside of the viewport or the camera view are skipped.
+// Returns the number of tiles drawn.
+uint32_t pge_tilesheet_draw_grid(GContext *ctx, PGETileSheetHandle handle, GRect box, GPoint position, GSize spacing);
+
+// Sets the visible rect in screen coordinates used to cull tiles, PGE_TILESHEET_DEFAULT_VIEWPORT by default
+void pge_tilesheet_set_viewport(PGETileSheetHandle handle, GRect viewport);
+
+GRect pge_tilesheet_get_viewport(PGETileSheetHandle handle);
+
+// Loads the chunks of a chunked tile sheet around visible_tiles (in tiles) and returns the tile bitmaps no longer
+// visible to the bitmap cache. Called by pge_tilesheet_draw_grid, other renderers should call it once per frame
+// with their visible tiles.
+void pge_tilesheet_stream(PGETileSheetHandle handle, GRect visible_tiles);
+
+// Animated tiles of all tile sheets are driven by one shared clock in milliseconds. Set it, or advance it once
+// per logic tick, before drawing. In PGERenderModeOnChange, call pge_mark_dirty() when the serial returned by
+// pge_tilesheet_update_animations changes, or the new frames are not drawn.
+void pge_tilesheet_set_anim_clock(uint32_t time_ms);
+
+void pge_tilesheet_advance_anim_clock(uint32_t elapsed_ms);
+
+// Moves the animated tiles of a tile sheet to their frame at the current clock. Called by pge_tilesheet_draw_grid,
+// does nothing if the clock did not change since the last update.
+// Returns a serial number incremented by every update that changed the frame of at least one animated tile.
+uint32_t pge_tilesheet_update_animations(PGETileSheetHandle handle);
+
+// Returns the serial number of the last update that changed the frame drawn at coordinate, 0 if it never changed.
+// Renderers caching tiles only need to redraw the tiles whose serial is newer than the one they last drew.
+uint32_t pge_tilesheet_get_tile_anim_serial(PGETileSheetHandle handle, GPoint coordinate);
+
+// Returns the bitmap of the tile at coordinate (the current frame for animated tiles), NULL for empty tiles and
+// coordinates outside of the tile sheet.
+// The bitmap is owned by the tile sheet and only stays valid until the next pge_tilesheet_stream or
+// pge_tilesheet_draw_grid call on it, which can return the bitmaps of tiles outside of the visible tiles to the
+// bitmap cache. Get the bitmap again each frame instead of keeping it.
+GBitmap* pge_tilesheet_get_tile_bitmap(PGETileSheetHandle handle, GPoint coordinate);
 
 GSize pge_tilesheet_get_tilesheet_size(PGETileSheetHandle handle);
 
+// Collision against the solid tiles of a tile sheet (tiles with the "solid" property in Tiled). Rects are in
+// tile sheet pixels, i.e. tile (x, y) covers GRect(x * tile_size.w, y * tile_size.h, tile_size.w, tile_size.h).
+// Only the cells covered by the rect (and by the movement for sweeps) are visited.
+
+// Returns true if the tile at coordinate is solid
+bool pge_tilesheet_is_solid(PGETileSheetHandle handle, GPoint coordinate);
+
+// Returns the number of solid tiles overlapping rect and writes the coordinates of up to max_tiles of them
+// to tiles (which can be NULL to only count them)
+uint32_t pge_tilesheet_get_solid_tiles(PGETileSheetHandle handle, GRect rect, GSize tile_size, GPoint *tiles, uint32_t max_tiles);
+
+// Returns how far rect can move along x, up to dx, before touching a solid tile
+int16_t pge_tilesheet_sweep_x(PGETileSheetHandle handle, GRect rect, GSize tile_size, int16_t dx);
+
+// Returns how far rect can move along y, up to dy, before touching a solid tile
+int16_t pge_tilesheet_sweep_y(PGETileSheetHandle handle, GRect rect, GSize tile_size, int16_t dy);
+
+// Returns how far rect can move by (dx, dy), moving along x first and then along y
+GPoint pge_tilesheet_sweep(PGETileSheetHandle handle, GRect rect, GSize tile_size, int16_t dx, int16_t dy);
+
 
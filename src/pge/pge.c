@@ -1,4 +1,5 @@
 #include "pge.h"
+#include "pge_profiler.h"
 
 // State
 static Window *s_game_window;
@@ -12,7 +13,82 @@ static PGERenderHandler *s_render_handler;
 static PGEClickHandler *s_click_handler;
 
 static bool s_button_states[3];
-static int s_framerate = 1000 / 30;
+static bool s_button_pressed[3];   // Pressed during the current tick
+static bool s_button_released[3];  // Released after being pressed during the current tick, cleared once the tick is over
+
+// Input events, written by the click recognizers and drained at the start of each logic tick
+static PGEInputEvent s_input_queue[PGE_INPUT_QUEUE_SIZE];
+static uint32_t s_input_head;  // Free running, only written by prv_push_input_event
+static uint32_t s_input_tail;  // Free running, only written by prv_drain_input_events
+static uint32_t s_input_overflow_count;
+
+// Events of the current logic tick, returned by pge_input_poll
+static PGEInputEvent s_tick_events[PGE_INPUT_QUEUE_SIZE];
+static uint32_t s_num_tick_events;
+static uint32_t s_tick_event_index;
+static int s_framerate = PGE_MAX_FRAMERATE;       // Current framerate, lowered by the governor when idle
+static int s_full_framerate = PGE_MAX_FRAMERATE;  // Framerate set with pge_set_framerate
+
+// Scheduler, times are absolute milliseconds from time_ms()
+static uint64_t s_schedule_start_ms;  // Deadline of the first logic tick at the current framerate
+static uint32_t s_schedule_ticks;     // Logic ticks run since s_schedule_start_ms
+static uint32_t s_dropped_ticks;
+
+// Render on change, the canvas is only redrawn after a logic tick if something marked it dirty
+static PGERenderMode s_render_mode = PGERenderModeContinuous;
+static bool s_dirty = true;
+
+// Framerate governor, steps the framerate down while nothing happens
+static bool s_governor_enabled;
+static uint32_t s_governor_idle_ticks = PGE_GOVERNOR_DEFAULT_IDLE_TICKS;  // Idle ticks before each step down
+static int s_governor_min_framerate = PGE_GOVERNOR_DEFAULT_MIN_FRAMERATE;
+static uint32_t s_idle_ticks;  // Ticks without input or dirty state at the current framerate
+
+// Frame statistics, measured over the last second
+static uint64_t s_last_render_ms;
+static uint64_t s_stats_start_ms;
+static uint32_t s_stats_frames;
+static uint32_t s_stats_jitter_total;
+static int s_measured_framerate;
+static int s_frame_jitter;
+
+static PGECamera s_camera = { .view = { { 0, 0 }, { 144, 168 } } };
+
+// Input log, a PGEInputLogHeader followed by records:
+//   0x80 | n         n logic ticks (1 - 127) ran
+//   (type << 2) | b  event of button b drained by the next tick, followed by the uint16_t milliseconds
+//                    since the previous event
+#define INPUT_LOG_MAGIC 0x52454750  // "PGER"
+#define INPUT_LOG_VERSION 1
+#define INPUT_LOG_TICKS 0x80
+#define INPUT_LOG_MAX_TICK_RUN 0x7F
+
+typedef struct {
+  uint32_t magic;
+  uint8_t version;
+  uint8_t framerate;    // Framerate set with pge_set_framerate when recording started
+  uint16_t reserved;
+  uint32_t num_ticks;
+} __attribute__((__packed__)) PGEInputLogHeader;
+
+static uint8_t *s_record_buffer;
+static size_t s_record_size;
+static size_t s_record_length;
+static size_t s_record_run_offset;     // Offset of the tick run that can still be extended, 0 if none
+static size_t s_record_tick_length;    // Length of the log up to the last recorded tick
+static uint32_t s_record_event_ms;     // Time of the previous recorded event
+static bool s_record_full;
+
+static const uint8_t *s_replay_log;
+static size_t s_replay_size;
+static size_t s_replay_offset;
+static uint32_t s_replay_run_ticks;    // Ticks left in the current tick run
+static uint32_t s_replay_event_ms;     // Time of the previous replayed event
+static uint32_t s_replay_num_ticks;
+static uint64_t s_replay_start_ms;
+static int s_replay_saved_framerate;
+static AppTimer *s_replay_timer;
+static PGEReplayFinishedHandler *s_replay_finished_handler;
 
 // Internal prototypes
 static void game_window_load(Window *window);
@@ -20,6 +96,13 @@ static void game_window_unload(Window *window);
 static void frame_timer_handler(void *context);
 static void draw_frame_update_proc(Layer *layer, GContext *ctx);
 static void click_config_provider(void *context);
+static uint64_t prv_now_ms();
+static uint64_t prv_next_deadline_ms();
+static void prv_governor_update(int ticks);
+static void prv_governor_wake();
+static void prv_run_logic_tick();
+static void prv_queue_input_event(ButtonId button, PGEInputEventType type, uint32_t time_ms);
+static void prv_replay_step(void *context);
 
 /*********************************** Engine ***********************************/
 
@@ -63,27 +146,111 @@ void pge_finish() {
     app_timer_cancel(s_render_timer);
     s_render_timer = NULL;
   }
+  if(s_replay_timer != NULL) {
+    app_timer_cancel(s_replay_timer);
+    s_replay_timer = NULL;
+  }
+  s_replay_log = NULL;
 
   // Finally
   window_destroy(s_game_window);
   s_game_window = NULL;
 }
 
-bool pge_get_button_state(ButtonId button) {
+static int prv_button_index(ButtonId button) {
   switch(button) {
     case BUTTON_ID_UP:
-      return s_button_states[0];
+      return 0;
     case BUTTON_ID_SELECT:
-      return s_button_states[1];
+      return 1;
     case BUTTON_ID_DOWN:
-      return s_button_states[2];
-    default: 
-      return false;
+      return 2;
+    default:
+      return -1;
   }
 }
 
-void pge_set_framerate(int new_rate) {
+bool pge_get_button_state(ButtonId button) {
+  int index = prv_button_index(button);
+  return (index >= 0) ? s_button_states[index] : false;
+}
+
+bool pge_input_poll(PGEInputEvent *event) {
+  if(event == NULL || s_tick_event_index >= s_num_tick_events) {
+    return false;
+  }
+  *event = s_tick_events[s_tick_event_index++];
+  return true;
+}
+
+uint32_t pge_input_get_overflow_count() {
+  return s_input_overflow_count;
+}
+
+static int prv_clamp_framerate(int rate) {
+  if(rate < 1) {
+    return 1;
+  } else if(rate > PGE_MAX_FRAMERATE) {
+    return PGE_MAX_FRAMERATE;
+  }
+  return rate;
+}
+
+static void prv_apply_framerate(int new_rate) {
+  // Keep the pending deadline, following ticks are spaced at the new rate
+  if(s_schedule_start_ms != 0) {
+    s_schedule_start_ms = prv_next_deadline_ms();
+    s_schedule_ticks = 0;
+  }
   s_framerate = new_rate;
+  s_idle_ticks = 0;
+}
+
+void pge_set_framerate(int new_rate) {
+  s_full_framerate = prv_clamp_framerate(new_rate);
+  prv_apply_framerate(s_full_framerate);
+}
+
+int pge_get_framerate() {
+  return s_framerate;
+}
+
+void pge_governor_set_enabled(bool enabled, uint32_t idle_ticks) {
+  s_governor_enabled = enabled;
+  s_governor_idle_ticks = (idle_ticks > 0) ? idle_ticks : 1;
+  if(!enabled && s_framerate != s_full_framerate) {
+    prv_apply_framerate(s_full_framerate);
+  }
+}
+
+void pge_governor_set_min_framerate(int min_rate) {
+  s_governor_min_framerate = prv_clamp_framerate(min_rate);
+  if(s_framerate < s_governor_min_framerate && s_governor_min_framerate <= s_full_framerate) {
+    prv_apply_framerate(s_governor_min_framerate);
+  }
+}
+
+PGEGovernorState pge_governor_get_state() {
+  if(!s_governor_enabled) {
+    return PGEGovernorStateOff;
+  } else if(s_framerate >= s_full_framerate) {
+    return PGEGovernorStateFull;
+  } else if(s_framerate <= s_governor_min_framerate) {
+    return PGEGovernorStateMinimum;
+  }
+  return PGEGovernorStateReduced;
+}
+
+int pge_get_measured_framerate() {
+  return s_measured_framerate;
+}
+
+int pge_get_frame_jitter() {
+  return s_frame_jitter;
+}
+
+uint32_t pge_get_dropped_ticks() {
+  return s_dropped_ticks;
 }
 
 void pge_set_background(int bg_resource_id) {
@@ -95,9 +262,215 @@ void pge_set_background(int bg_resource_id) {
 }
 
 void pge_manual_advance() {
+  if(s_logic_handler != NULL) {
+    prv_run_logic_tick();
+  }
+  s_dirty = true;
   layer_mark_dirty(s_canvas);
 }
 
+void pge_set_render_mode(PGERenderMode mode) {
+  s_render_mode = mode;
+
+  // Start the new mode with an up to date frame
+  s_dirty = true;
+}
+
+PGERenderMode pge_get_render_mode() {
+  return s_render_mode;
+}
+
+void pge_mark_dirty() {
+  s_dirty = true;
+}
+
+bool pge_is_dirty() {
+  return s_dirty;
+}
+
+/******************************* Record / Replay *******************************/
+
+bool pge_record_start(uint8_t *buffer, size_t size) {
+  if(buffer == NULL || size < sizeof(PGEInputLogHeader)) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Invalid input log buffer");
+    return false;
+  }
+
+  PGEInputLogHeader header = {
+    .magic = INPUT_LOG_MAGIC,
+    .version = INPUT_LOG_VERSION,
+    .framerate = s_full_framerate
+  };
+  memcpy(buffer, &header, sizeof(header));
+
+  s_record_buffer = buffer;
+  s_record_size = size;
+  s_record_length = sizeof(header);
+  s_record_run_offset = 0;
+  s_record_tick_length = s_record_length;
+  s_record_event_ms = (uint32_t)prv_now_ms();
+  s_record_full = false;
+
+  // The log only stores the full framerate, the governor is held there until the recording stops
+  prv_governor_wake();
+  return true;
+}
+
+size_t pge_record_stop() {
+  // Events drained by the tick that stopped the recording, such as the click that stopped it, are left out
+  size_t length = (s_record_buffer != NULL) ? s_record_tick_length : 0;
+  s_record_buffer = NULL;
+  return length;
+}
+
+bool pge_is_recording() {
+  return s_record_buffer != NULL;
+}
+
+// Stops the recording for good once the buffer is full, the log is cut after the last complete tick so that
+// a replay never runs events without their tick
+static bool prv_record_bytes(const uint8_t *bytes, size_t length) {
+  if(s_record_full) {
+    return false;
+  }
+  if(s_record_length + length > s_record_size) {
+    s_record_length = s_record_tick_length;
+    s_record_run_offset = 0;
+    s_record_full = true;
+    APP_LOG(APP_LOG_LEVEL_WARNING, "Input log full, recording stopped after %ld bytes", (uint32_t)s_record_length);
+    return false;
+  }
+
+  memcpy(&s_record_buffer[s_record_length], bytes, length);
+  s_record_length += length;
+  return true;
+}
+
+static void prv_record_event(PGEInputEvent *event) {
+  if(s_record_full) {
+    return;
+  }
+
+  uint32_t delta = event->time_ms - s_record_event_ms;
+  if(delta > UINT16_MAX) {
+    delta = UINT16_MAX;
+  }
+  s_record_event_ms += delta;
+
+  uint8_t record[3] = { (event->type << 2) | (event->button & 0x3), delta & 0xFF, delta >> 8 };
+  if(prv_record_bytes(record, sizeof(record))) {
+    s_record_run_offset = 0;
+  }
+}
+
+static void prv_record_tick() {
+  if(s_record_full) {
+    return;
+  }
+
+  if(s_record_run_offset != 0 && (s_record_buffer[s_record_run_offset] & INPUT_LOG_MAX_TICK_RUN) < INPUT_LOG_MAX_TICK_RUN) {
+    s_record_buffer[s_record_run_offset]++;
+  } else {
+    uint8_t record = INPUT_LOG_TICKS | 1;
+    if(!prv_record_bytes(&record, sizeof(record))) {
+      return;
+    }
+    s_record_run_offset = s_record_length - 1;
+  }
+  s_record_tick_length = s_record_length;
+  ((PGEInputLogHeader *)s_record_buffer)->num_ticks++;
+}
+
+bool pge_replay_start(const uint8_t *log, size_t size, PGEReplayFinishedHandler *finished_handler) {
+  PGEInputLogHeader header;
+  if(log == NULL || size < sizeof(header)) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Invalid input log");
+    return false;
+  }
+  memcpy(&header, log, sizeof(header));
+  if(header.magic != INPUT_LOG_MAGIC || header.version != INPUT_LOG_VERSION) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unsupported input log");
+    return false;
+  }
+  if(s_logic_handler == NULL || s_render_handler == NULL || s_replay_log != NULL) {
+    return false;
+  }
+
+  // Live frames stop, the replay drives the handlers
+  if(s_render_timer != NULL) {
+    app_timer_cancel(s_render_timer);
+    s_render_timer = NULL;
+  }
+  s_input_tail = s_input_head;
+
+  s_replay_log = log;
+  s_replay_size = size;
+  s_replay_offset = sizeof(header);
+  s_replay_run_ticks = 0;
+  s_replay_num_ticks = 0;
+  s_replay_start_ms = prv_now_ms();
+  s_replay_event_ms = (uint32_t)s_replay_start_ms;
+  s_replay_finished_handler = finished_handler;
+  s_replay_saved_framerate = s_framerate;
+  s_framerate = prv_clamp_framerate(header.framerate);
+  s_replay_timer = app_timer_register(0, prv_replay_step, NULL);
+  return true;
+}
+
+bool pge_is_replaying() {
+  return s_replay_log != NULL;
+}
+
+/*********************************** Camera ***********************************/
+
+void pge_camera_set_position(GPoint position) {
+  s_camera.position = position;
+}
+
+void pge_camera_move(int dx, int dy) {
+  s_camera.position.x += dx;
+  s_camera.position.y += dy;
+}
+
+GPoint pge_camera_get_position() {
+  return s_camera.position;
+}
+
+void pge_camera_set_view(GRect view) {
+  s_camera.view = view;
+}
+
+GRect pge_camera_get_view() {
+  return s_camera.view;
+}
+
+PGECamera pge_camera_get() {
+  return s_camera;
+}
+
+GPoint pge_camera_world_to_screen(GPoint world_point) {
+  return GPoint(world_point.x - s_camera.position.x + s_camera.view.origin.x,
+                world_point.y - s_camera.position.y + s_camera.view.origin.y);
+}
+
+GPoint pge_camera_screen_to_world(GPoint screen_point) {
+  return GPoint(screen_point.x - s_camera.view.origin.x + s_camera.position.x,
+                screen_point.y - s_camera.view.origin.y + s_camera.position.y);
+}
+
+bool pge_camera_cull(GRect world_rect, GRect *screen_rect) {
+  GRect rect = world_rect;
+  rect.origin = pge_camera_world_to_screen(world_rect.origin);
+  if (screen_rect) {
+    *screen_rect = rect;
+  }
+
+  return (rect.origin.x < s_camera.view.origin.x + s_camera.view.size.w) &&
+         (rect.origin.y < s_camera.view.origin.y + s_camera.view.size.h) &&
+         (rect.origin.x + rect.size.w > s_camera.view.origin.x) &&
+         (rect.origin.y + rect.size.h > s_camera.view.origin.y);
+}
+
 /************************* Engine Internal Functions **************************/
 
 static void game_window_load(Window *window) {
@@ -113,8 +486,13 @@ static void game_window_load(Window *window) {
   layer_set_update_proc(s_canvas, draw_frame_update_proc);
   layer_add_child(window_layer, s_canvas);
 
-  // Register new Timer to begin frame rendering loop
-  s_render_timer = app_timer_register(1000 / s_framerate, frame_timer_handler, NULL);
+  // Register new Timer to begin frame rendering loop, the first logic tick is due now
+  uint64_t now = prv_now_ms();
+  s_schedule_start_ms = now;
+  s_schedule_ticks = 0;
+  s_stats_start_ms = now;
+  s_last_render_ms = 0;
+  s_render_timer = app_timer_register(1, frame_timer_handler, NULL);
 }
 
 static void game_window_unload(Window *window) {
@@ -125,74 +503,332 @@ static void game_window_unload(Window *window) {
   s_bg_bitmap = NULL;
 }
 
-static void frame_timer_handler(void *context) {
-  if(s_logic_handler != NULL && s_render_handler != NULL) {
-    // Do this frame
+static uint64_t prv_now_ms() {
+  time_t seconds;
+  uint16_t ms;
+  time_ms(&seconds, &ms);
+  return ((uint64_t)seconds * 1000) + ms;
+}
+
+// Deadlines are computed from the start of the schedule rather than by adding 1000 / s_framerate
+// to the previous one, so the rounding of the period and the time spent in a frame do not accumulate
+static uint64_t prv_next_deadline_ms() {
+  return s_schedule_start_ms + (((uint64_t)s_schedule_ticks * 1000) / s_framerate);
+}
+
+// Step the framerate down after s_governor_idle_ticks ticks without dirty state, back up as soon as
+// something is dirty again
+static void prv_governor_update(int ticks) {
+  if(!s_governor_enabled || s_record_buffer != NULL) {
+    return;
+  }
+
+  if(s_dirty) {
+    if(s_framerate != s_full_framerate) {
+      prv_apply_framerate(s_full_framerate);
+    }
+    s_idle_ticks = 0;
+    return;
+  }
+
+  s_idle_ticks += ticks;
+  if(s_idle_ticks >= s_governor_idle_ticks && s_framerate > s_governor_min_framerate) {
+    int rate = s_framerate / 2;
+    prv_apply_framerate((rate > s_governor_min_framerate) ? rate : s_governor_min_framerate);
+  }
+}
+
+// Back to the full framerate right away, the next tick runs now instead of at the slow deadline
+static void prv_governor_wake() {
+  s_idle_ticks = 0;
+  if(!s_governor_enabled || s_framerate == s_full_framerate) {
+    return;
+  }
+
+  s_framerate = s_full_framerate;
+  s_schedule_start_ms = prv_now_ms();
+  s_schedule_ticks = 0;
+  if(s_render_timer != NULL) {
+    app_timer_reschedule(s_render_timer, 1);
+  }
+}
+
+// Apply the queued input events to the button states and click handler, and keep them for pge_input_poll
+static void prv_drain_input_events() {
+  s_num_tick_events = 0;
+  s_tick_event_index = 0;
+
+  uint32_t head = s_input_head;
+  while(s_input_tail != head) {
+    PGEInputEvent event = s_input_queue[s_input_tail % PGE_INPUT_QUEUE_SIZE];
+    s_input_tail++;
+    s_tick_events[s_num_tick_events++] = event;
+    if(s_record_buffer != NULL) {
+      prv_record_event(&event);
+    }
+
+    int index = prv_button_index((ButtonId)event.button);
+    if(index < 0) {
+      continue;
+    }
+
+    switch(event.type) {
+      case PGEInputEventDown:
+        s_button_states[index] = true;
+        s_button_pressed[index] = true;
+        s_button_released[index] = false;
+        break;
+      case PGEInputEventUp:
+        // A press and release between two ticks still reads as pressed for one tick
+        if(s_button_pressed[index]) {
+          s_button_released[index] = true;
+        } else {
+          s_button_states[index] = false;
+        }
+        break;
+      case PGEInputEventClick:
+      case PGEInputEventLongClick:
+        if(s_click_handler != NULL) {
+          s_click_handler(event.button, event.type == PGEInputEventLongClick);
+        }
+        break;
+    }
+  }
+}
+
+static void prv_run_logic_tick() {
+  bool was_replaying = (s_replay_log != NULL);
+  prv_drain_input_events();
+
+  // A replay started by a click handler takes over before the logic of this live tick runs
+  if(!was_replaying && s_replay_log != NULL) {
+    return;
+  }
+
+  PGE_PROFILER_BEGIN(logic);
+  s_logic_handler();
+  PGE_PROFILER_END(logic);
+
+  if(s_record_buffer != NULL) {
+    prv_record_tick();
+  }
+
+  for(int i = 0; i < 3; i++) {
+    if(s_button_released[i]) {
+      s_button_states[i] = false;
+    }
+    s_button_pressed[i] = false;
+    s_button_released[i] = false;
+  }
+}
+
+static void prv_replay_finish() {
+  uint32_t elapsed_ms = (uint32_t)(prv_now_ms() - s_replay_start_ms);
+  s_replay_log = NULL;
+  s_framerate = s_replay_saved_framerate;
+
+  // Back to live frames
+  s_schedule_start_ms = prv_now_ms();
+  s_schedule_ticks = 0;
+  if(s_render_timer == NULL) {
+    s_render_timer = app_timer_register(1, frame_timer_handler, NULL);
+  }
+
+  if(s_replay_finished_handler != NULL) {
+    s_replay_finished_handler(s_replay_num_ticks, elapsed_ms);
+  }
+}
+
+// Run the next recorded tick with its events, right away instead of at the next deadline
+static void prv_replay_step(void *context) {
+  s_replay_timer = NULL;
+  while(s_replay_run_ticks == 0) {
+    if(s_replay_offset >= s_replay_size) {
+      prv_replay_finish();
+      return;
+    }
+
+    uint8_t record = s_replay_log[s_replay_offset++];
+    if(record & INPUT_LOG_TICKS) {
+      s_replay_run_ticks = record & INPUT_LOG_MAX_TICK_RUN;
+      continue;
+    }
+    if(s_replay_offset + 2 > s_replay_size) {
+      prv_replay_finish();
+      return;
+    }
+
+    s_replay_event_ms += s_replay_log[s_replay_offset] | (s_replay_log[s_replay_offset + 1] << 8);
+    s_replay_offset += 2;
+    prv_queue_input_event((ButtonId)(record & 0x3), (PGEInputEventType)(record >> 2), s_replay_event_ms);
+  }
+
+  s_replay_run_ticks--;
+  prv_run_logic_tick();
+  s_replay_num_ticks++;
+
+  // The next step follows the render when there is one, see draw_frame_update_proc
+  if(s_render_mode == PGERenderModeContinuous || s_dirty) {
     layer_mark_dirty(s_canvas);
+  } else {
+    s_replay_timer = app_timer_register(0, prv_replay_step, NULL);
+  }
+}
 
-    // Next frame
-    s_render_timer = app_timer_register(1000 / s_framerate, frame_timer_handler, NULL);
+static void frame_timer_handler(void *context) {
+  s_render_timer = NULL;
+  if(s_logic_handler != NULL && s_render_handler != NULL) {
+    // Run the logic ticks that are due, catching up on late ones
+    uint64_t now = prv_now_ms();
+    int ticks = 0;
+    while(prv_next_deadline_ms() <= now && ticks < PGE_MAX_CATCHUP_TICKS) {
+      prv_run_logic_tick();
+      s_schedule_ticks++;
+      ticks++;
+
+      // A replay started by this tick drives the handlers from now on, see prv_replay_step
+      if(s_replay_log != NULL) {
+        break;
+      }
+    }
+
+    if(s_replay_log == NULL && prv_next_deadline_ms() <= now) {
+      // Too far behind to catch up, drop the missed ticks and count the one just run as due now
+      s_dropped_ticks += (uint32_t)(((now - prv_next_deadline_ms()) * s_framerate) / 1000) + 1;
+      s_schedule_start_ms = now;
+      s_schedule_ticks = 1;
+    }
+
+    // Render once for all the ticks run, unless nothing changed in render on change mode
+    if(ticks > 0 && (s_render_mode == PGERenderModeContinuous || s_dirty)) {
+      layer_mark_dirty(s_canvas);
+    }
+
+    if(ticks > 0) {
+      prv_governor_update(ticks);
+    }
+
+    // Next frame, against the absolute deadline. Live frames resume when the replay finishes
+    if(s_replay_log == NULL) {
+      uint64_t deadline = prv_next_deadline_ms();
+      now = prv_now_ms();
+      s_render_timer = app_timer_register((deadline > now) ? (uint32_t)(deadline - now) : 1, frame_timer_handler, NULL);
+    }
+
+    PGE_PROFILER_UPDATE();
   } else {
     APP_LOG(APP_LOG_LEVEL_ERROR, "Loop or Render handler not set!");
   }
 }
 
+// Measure the framerate and how far frame intervals are from the target period
+static void prv_update_frame_stats() {
+  uint64_t now = prv_now_ms();
+  if(s_last_render_ms != 0) {
+    int32_t deviation = (int32_t)(now - s_last_render_ms) - (1000 / s_framerate);
+    s_stats_jitter_total += (deviation < 0) ? -deviation : deviation;
+    s_stats_frames++;
+  }
+  s_last_render_ms = now;
+
+  if(now - s_stats_start_ms >= 1000) {
+    s_measured_framerate = (s_stats_frames * 1000) / (uint32_t)(now - s_stats_start_ms);
+    s_frame_jitter = (s_stats_frames > 0) ? (s_stats_jitter_total / s_stats_frames) : 0;
+    s_stats_start_ms = now;
+    s_stats_frames = 0;
+    s_stats_jitter_total = 0;
+  }
+}
+
 static void draw_frame_update_proc(Layer *layer, GContext *ctx) {
-  // Render and logic
+  // Render only, logic runs from the frame timer
   if(s_logic_handler != NULL && s_render_handler != NULL) {
+    PGE_PROFILER_BEGIN(render);
     s_render_handler(ctx);
-    s_logic_handler();
+    PGE_PROFILER_END(render);
+    s_dirty = false;
+    prv_update_frame_stats();
+
+    if(s_replay_log != NULL && s_replay_timer == NULL) {
+      s_replay_timer = app_timer_register(0, prv_replay_step, NULL);
+    }
   } else {
     APP_LOG(APP_LOG_LEVEL_ERROR, "Loop or Render handler not set!");
   }
 }
 
+// Only writes s_input_head so the frame loop can drain concurrently
+static void prv_queue_input_event(ButtonId button, PGEInputEventType type, uint32_t time_ms) {
+  if(s_input_head - s_input_tail >= PGE_INPUT_QUEUE_SIZE) {
+    s_input_overflow_count++;
+    return;
+  }
+
+  PGEInputEvent *event = &s_input_queue[s_input_head % PGE_INPUT_QUEUE_SIZE];
+  event->time_ms = time_ms;
+  event->button = button;
+  event->type = type;
+  s_input_head++;
+}
+
+// Called from the click recognizers, live input is ignored while a replay drives the game
+static void prv_push_input_event(ButtonId button, PGEInputEventType type) {
+  if(s_replay_log != NULL) {
+    return;
+  }
+
+  if(type == PGEInputEventDown) {
+    prv_governor_wake();
+  }
+  prv_queue_input_event(button, type, (uint32_t)prv_now_ms());
+}
+
 static void up_pressed_click_handler(ClickRecognizerRef recognizer, void *context) {
-  s_button_states[0] = true;
+  prv_push_input_event(BUTTON_ID_UP, PGEInputEventDown);
 }
 
 static void up_released_click_handler(ClickRecognizerRef recognizer, void *context) {
-  s_button_states[0] = false;
+  prv_push_input_event(BUTTON_ID_UP, PGEInputEventUp);
 }
 
 static void select_pressed_click_handler(ClickRecognizerRef recognizer, void *context) {
-  s_button_states[1] = true;
+  prv_push_input_event(BUTTON_ID_SELECT, PGEInputEventDown);
 }
 
 static void select_released_click_handler(ClickRecognizerRef recognizer, void *context) {
-  s_button_states[1] = false;
+  prv_push_input_event(BUTTON_ID_SELECT, PGEInputEventUp);
 }
 
 static void down_pressed_click_handler(ClickRecognizerRef recognizer, void *context) {
-  s_button_states[2] = true;
+  prv_push_input_event(BUTTON_ID_DOWN, PGEInputEventDown);
 }
 
 static void down_released_click_handler(ClickRecognizerRef recognizer, void *context) {
-  s_button_states[2] = false;
+  prv_push_input_event(BUTTON_ID_DOWN, PGEInputEventUp);
 }
 
 static void select_click_handler(ClickRecognizerRef recognizer, void *context) {
-  s_click_handler(BUTTON_ID_SELECT, false);
+  prv_push_input_event(BUTTON_ID_SELECT, PGEInputEventClick);
 }
 
 static void up_click_handler(ClickRecognizerRef recognizer, void *context) {
-  s_click_handler(BUTTON_ID_UP, false);
+  prv_push_input_event(BUTTON_ID_UP, PGEInputEventClick);
 }
 
 static void down_click_handler(ClickRecognizerRef recognizer, void *context) {
-  s_click_handler(BUTTON_ID_DOWN, false);
+  prv_push_input_event(BUTTON_ID_DOWN, PGEInputEventClick);
 }
 
 static void select_long_click_handler(ClickRecognizerRef recognizer, void *context) {
-  s_click_handler(BUTTON_ID_SELECT, true);
+  prv_push_input_event(BUTTON_ID_SELECT, PGEInputEventLongClick);
 }
 
 static void up_long_click_handler(ClickRecognizerRef recognizer, void *context) {
-  s_click_handler(BUTTON_ID_UP, true);
+  prv_push_input_event(BUTTON_ID_UP, PGEInputEventLongClick);
 }
 
 static void down_long_click_handler(ClickRecognizerRef recognizer, void *context) {
-  s_click_handler(BUTTON_ID_DOWN, true);
+  prv_push_input_event(BUTTON_ID_DOWN, PGEInputEventLongClick);
 }
 
 static void click_config_provider(void *context) {
@@ -10,8 +10,14 @@
  * Features:
  * - 30 frames per second
  * - Automatic game loop using PGELogicHandler and PGERenderHandler
- * - Customizable framerate
+ * - Customizable framerate, logic runs at a fixed timestep scheduled against absolute deadlines
+ * - Measured framerate and frame time jitter
+ * - Render on change mode, redrawing only when the game marks the scene dirty
+ * - Framerate governor lowering the framerate of idle scenes
  * - Easy to use button events, as well as query functions
+ * - Timestamped input event queue drained once per logic tick
+ * - Deterministic input record and replay at full speed for benchmarks
+ * - Camera translating world coordinates to the screen, with culling of anything outside its view
  *
  * Abstracted Pebble APIs (DO NOT REIMPLEMENT!):
  * - Clicks using a PGEClickHandler
@@ -25,15 +31,58 @@
 
 /********************************** Engine ***********************************/
 
+#define PGE_MAX_FRAMERATE 30
+
+// Maximum number of late logic ticks run back to back before a render, further missed ticks are dropped
+#ifndef PGE_MAX_CATCHUP_TICKS
+#define PGE_MAX_CATCHUP_TICKS 4
+#endif
+
+// Number of input events held between two logic ticks, further events are dropped and counted
+#ifndef PGE_INPUT_QUEUE_SIZE
+#define PGE_INPUT_QUEUE_SIZE 16
+#endif
+
+#define PGE_GOVERNOR_DEFAULT_IDLE_TICKS 30
+#define PGE_GOVERNOR_DEFAULT_MIN_FRAMERATE 1
+
 // Function for user to place their per-frame game logic
 typedef void (PGELogicHandler)();
 
 // Function for user to use the GContext to draw their game items
 typedef void (PGERenderHandler)(GContext *ctx);
 
-// Function for user to implement button clicks
+// Function for user to implement button clicks, called at the start of the logic tick following the click
 typedef void (PGEClickHandler)(int button_id, bool long_click);
 
+typedef enum {
+  PGEInputEventDown = 0,
+  PGEInputEventUp,
+  PGEInputEventClick,
+  PGEInputEventLongClick
+} PGEInputEventType;
+
+// Function called when a replay started with pge_replay_start has run all its ticks
+typedef void (PGEReplayFinishedHandler)(uint32_t num_ticks, uint32_t elapsed_ms);
+
+typedef struct {
+  uint32_t time_ms;  // When the event happened, low 32 bits of the time_ms() clock in milliseconds
+  uint8_t button;    // ButtonId
+  uint8_t type;      // PGEInputEventType
+} PGEInputEvent;
+
+typedef enum {
+  PGEGovernorStateOff = 0,  // Governor disabled, the framerate stays at the one set with pge_set_framerate
+  PGEGovernorStateFull,     // Running at the framerate set with pge_set_framerate
+  PGEGovernorStateReduced,  // Stepped down after idle ticks, above the minimum framerate
+  PGEGovernorStateMinimum   // Idle at the minimum framerate
+} PGEGovernorState;
+
+typedef enum {
+  PGERenderModeContinuous = 0,  // Render after every batch of logic ticks
+  PGERenderModeOnChange         // Render only after a logic tick or click marked the scene dirty
+} PGERenderMode;
+
 // Implement app setup here
 void pge_init();
 
@@ -53,21 +102,188 @@ Window* pge_begin(GColor window_color, PGELogicHandler *logic_handler, PGERender
 void pge_finish();
 
 /**
- * Query the current state of a button
+ * Query the current state of a button. A button pressed and released between two logic ticks reads as
+ * pressed during the next tick.
  */
 bool pge_get_button_state(ButtonId button);
 
 /**
- * Set the desired framerate (0 - 30)
+ * Get the next input event of the current logic tick, oldest first. Returns false when all events of
+ * the tick have been read. Call from the PGELogicHandler.
+ */
+bool pge_input_poll(PGEInputEvent *event);
+
+/**
+ * Get the number of input events dropped because more than PGE_INPUT_QUEUE_SIZE arrived between two ticks
+ */
+uint32_t pge_input_get_overflow_count();
+
+/**
+ * Set the desired framerate in frames per second (1 - PGE_MAX_FRAMERATE).
+ * The PGELogicHandler runs exactly this many times per second, late ticks are caught up before the
+ * next render. The PGERenderHandler runs once after each batch of logic ticks.
  */
 void pge_set_framerate(int new_rate);
 
+/**
+ * Get the current framerate in frames per second, lower than the desired one while the governor has
+ * stepped down
+ */
+int pge_get_framerate();
+
+/**
+ * Enable the framerate governor. After idle_ticks logic ticks without a button press or pge_mark_dirty(),
+ * the framerate is halved, and again after each further idle_ticks, down to the minimum framerate.
+ * The next button press goes back to the full framerate immediately, the next pge_mark_dirty() on the
+ * following tick. Games that animate must mark the scene dirty while they do.
+ * The governor holds the full framerate while input is recorded or replayed.
+ */
+void pge_governor_set_enabled(bool enabled, uint32_t idle_ticks);
+
+/**
+ * Pin the lowest framerate the governor steps down to, PGE_GOVERNOR_DEFAULT_MIN_FRAMERATE by default
+ */
+void pge_governor_set_min_framerate(int min_rate);
+
+/**
+ * Get the current state of the governor
+ */
+PGEGovernorState pge_governor_get_state();
+
+/**
+ * Get the number of frames rendered during the last second
+ */
+int pge_get_measured_framerate();
+
+/**
+ * Get the average distance in milliseconds between the frame intervals of the last second and the
+ * desired frame period
+ */
+int pge_get_frame_jitter();
+
+/**
+ * Get the number of logic ticks dropped because the game fell more than PGE_MAX_CATCHUP_TICKS behind
+ */
+uint32_t pge_get_dropped_ticks();
+
+/**
+ * Start recording the input events and logic ticks to buffer, about one byte per idle stretch of up to
+ * 127 ticks plus three bytes per event. Recording stops by itself when the buffer is full, the log then
+ * ends with the last tick that fit. The framerate governor stays at the full framerate while recording
+ * and replaying, so pge_get_framerate() returns the same value in both.
+ * Returns false if the buffer is too small for the log header.
+ */
+bool pge_record_start(uint8_t *buffer, size_t size);
+
+/**
+ * Stop recording, returns the size in bytes of the log in the buffer given to pge_record_start
+ */
+size_t pge_record_stop();
+
+/**
+ * Query whether input is being recorded
+ */
+bool pge_is_recording();
+
+/**
+ * Replay a log made with pge_record_start. Each recorded tick runs the PGELogicHandler with the events
+ * it drained when recorded, followed by the PGERenderHandler when rendering is due, back to back without
+ * waiting for frame deadlines, so a recorded session becomes a throughput benchmark. Live input is ignored
+ * until the log ends, then finished_handler (can be NULL) is called and live frames resume.
+ * Replays are deterministic as long as the game logic only depends on its ticks and input events.
+ * The log must stay valid until the replay has finished.
+ */
+bool pge_replay_start(const uint8_t *log, size_t size, PGEReplayFinishedHandler *finished_handler);
+
+/**
+ * Query whether a replay is running
+ */
+bool pge_is_replaying();
+
 /**
  * Set the fullscreen background image
  */
 void pge_set_background(int bg_resource_id);
 
 /**
- * Manually request a new frame to be rendered
+ * Manually request a new frame: run one logic tick now and render
+ */
+void pge_manual_advance();
+
+/**
+ * Set when the canvas is redrawn, PGERenderModeContinuous by default.
+ * In PGERenderModeOnChange logic keeps running at the framerate but the canvas is only redrawn once
+ * pge_mark_dirty() was called, so idle screens such as a paused game cost no rendering.
+ */
+void pge_set_render_mode(PGERenderMode mode);
+
+/**
+ * Get when the canvas is redrawn
+ */
+PGERenderMode pge_get_render_mode();
+
+/**
+ * Request a redraw after the current logic tick in PGERenderModeOnChange
+ */
+void pge_mark_dirty();
+
+/**
+ * Query whether a redraw is pending
+ */
+bool pge_is_dirty();
+
+/********************************** Camera ***********************************/
+
+// The camera maps world coordinates to the screen: the world point at position is drawn at the top left of
+// view, and anything outside of view is not drawn. Sprite, sprite sheet and tile sheet draws take world
+// coordinates and go through the camera. The default camera (position 0,0 and a full screen view) leaves
+// coordinates unchanged.
+typedef struct {
+  GPoint position;  // World position shown at the top left of the view
+  GRect view;       // Rect on screen the world is drawn into
+} PGECamera;
+
+/**
+ * Set the world position shown at the top left of the camera view
+ */
+void pge_camera_set_position(GPoint position);
+
+/**
+ * Move the camera by a number of world pixels
+ */
+void pge_camera_move(int dx, int dy);
+
+/**
+ * Get the world position shown at the top left of the camera view
+ */
+GPoint pge_camera_get_position();
+
+/**
+ * Set the rect on screen the world is drawn into, the full screen by default
+ */
+void pge_camera_set_view(GRect view);
+
+/**
+ * Get the rect on screen the world is drawn into
+ */
+GRect pge_camera_get_view();
+
+/**
+ * Get the current camera
+ */
+PGECamera pge_camera_get();
+
+/**
+ * Convert a world point to a screen point
+ */
+GPoint pge_camera_world_to_screen(GPoint world_point);
+
+/**
+ * Convert a screen point to a world point
+ */
+GPoint pge_camera_screen_to_world(GPoint screen_point);
+
+/**
+ * Convert a world rect to the screen, returns false without drawing anything if it is entirely outside of the view
  */
-void pge_manual_advance();
\ No newline at end of file
+bool pge_camera_cull(GRect world_rect, GRect *screen_rect);
\ No newline at end of file
@@ -0,0 +1,132 @@
+#ifdef PGE_PROFILER
+
+#include "pge_profiler.h"
+
+static PGEProfilerSample s_samples[PGE_PROFILER_RING_SIZE];
+static uint32_t s_num_samples;          // Samples recorded since the profiler started, s_samples wraps around
+
+static uint64_t s_epoch_ms;             // Time of the first call, sample times are relative to it
+static uint64_t s_summary_start_ms;     // Start of the second being counted
+static uint32_t s_summary_first_sample; // First sample of the second being counted
+
+static uint32_t s_counters[PGEProfilerCounterCount];       // Counts of the current second
+static uint32_t s_last_counters[PGEProfilerCounterCount];  // Counts of the last summarized second
+
+static const char *s_counter_names[PGEProfilerCounterCount] = {
+  "png", "res_bytes", "bmp+", "bmp-", "tiles", "sprites"
+};
+
+typedef struct {
+  const char *name;
+  uint32_t count;
+  uint32_t total_ms;
+  uint32_t max_ms;
+} PGEProfilerScopeSummary;
+
+uint64_t pge_profiler_now_ms() {
+  time_t seconds;
+  uint16_t ms;
+  time_ms(&seconds, &ms);
+  uint64_t now = ((uint64_t)seconds * 1000) + ms;
+  if (s_epoch_ms == 0) {
+    s_epoch_ms = now;
+    s_summary_start_ms = now;
+  }
+  return now;
+}
+
+void pge_profiler_record(const char *name, uint64_t start_ms) {
+  uint64_t now = pge_profiler_now_ms();
+  PGEProfilerSample *sample = &s_samples[s_num_samples % PGE_PROFILER_RING_SIZE];
+  sample->name = name;
+  sample->start_ms = (uint32_t)(start_ms - s_epoch_ms);
+  sample->duration_ms = (now - start_ms > UINT16_MAX) ? UINT16_MAX : (uint16_t)(now - start_ms);
+  s_num_samples++;
+}
+
+void pge_profiler_count(PGEProfilerCounter counter, uint32_t amount) {
+  if (counter < PGEProfilerCounterCount) {
+    s_counters[counter] += amount;
+  }
+}
+
+// Group the samples of the second being counted by scope name
+static uint32_t prv_summarize(PGEProfilerScopeSummary *scopes, uint32_t *num_lost) {
+  uint32_t first = s_summary_first_sample;
+  *num_lost = 0;
+  if (s_num_samples - first > PGE_PROFILER_RING_SIZE) {
+    *num_lost = s_num_samples - first - PGE_PROFILER_RING_SIZE;
+    first = s_num_samples - PGE_PROFILER_RING_SIZE;
+  }
+
+  uint32_t num_scopes = 0;
+  for (uint32_t i = first; i < s_num_samples; i++) {
+    PGEProfilerSample *sample = &s_samples[i % PGE_PROFILER_RING_SIZE];
+    uint32_t scope = 0;
+    while ((scope < num_scopes) && (strcmp(scopes[scope].name, sample->name) != 0)) {
+      scope++;
+    }
+    if (scope == num_scopes) {
+      if (num_scopes == PGE_PROFILER_MAX_SCOPES) {
+        (*num_lost)++;
+        continue;
+      }
+      memset(&scopes[scope], 0, sizeof(PGEProfilerScopeSummary));
+      scopes[scope].name = sample->name;
+      num_scopes++;
+    }
+
+    scopes[scope].count++;
+    scopes[scope].total_ms += sample->duration_ms;
+    if (sample->duration_ms > scopes[scope].max_ms) {
+      scopes[scope].max_ms = sample->duration_ms;
+    }
+  }
+  return num_scopes;
+}
+
+void pge_profiler_update() {
+  uint64_t now = pge_profiler_now_ms();
+  if (now - s_summary_start_ms < 1000) {
+    return;
+  }
+
+  PGEProfilerScopeSummary scopes[PGE_PROFILER_MAX_SCOPES];
+  uint32_t num_lost;
+  uint32_t num_scopes = prv_summarize(scopes, &num_lost);
+  for (uint32_t i = 0; i < num_scopes; i++) {
+    APP_LOG(APP_LOG_LEVEL_INFO, "prof %s: %ldx total %ldms max %ldms", scopes[i].name, scopes[i].count,
+            scopes[i].total_ms, scopes[i].max_ms);
+  }
+  if (num_lost > 0) {
+    APP_LOG(APP_LOG_LEVEL_INFO, "prof: %ld samples not summarized, raise PGE_PROFILER_RING_SIZE", num_lost);
+  }
+  APP_LOG(APP_LOG_LEVEL_INFO, "prof %s %ld %s %ld %s %ld %s %ld %s %ld %s %ld",
+          s_counter_names[0], s_counters[0], s_counter_names[1], s_counters[1], s_counter_names[2], s_counters[2],
+          s_counter_names[3], s_counters[3], s_counter_names[4], s_counters[4], s_counter_names[5], s_counters[5]);
+
+  // Start the next second
+  memcpy(s_last_counters, s_counters, sizeof(s_counters));
+  memset(s_counters, 0, sizeof(s_counters));
+  s_summary_start_ms = now;
+  s_summary_first_sample = s_num_samples;
+}
+
+uint32_t pge_profiler_get_counter(PGEProfilerCounter counter) {
+  return (counter < PGEProfilerCounterCount) ? s_last_counters[counter] : 0;
+}
+
+uint32_t pge_profiler_get_samples(PGEProfilerSample *samples, uint32_t max_samples) {
+  if (!samples) {
+    return 0;
+  }
+
+  uint32_t num_available = (s_num_samples < PGE_PROFILER_RING_SIZE) ? s_num_samples : PGE_PROFILER_RING_SIZE;
+  uint32_t num_copied = (max_samples < num_available) ? max_samples : num_available;
+  for (uint32_t i = 0; i < num_copied; i++) {
+    samples[i] = s_samples[(s_num_samples - 1 - i) % PGE_PROFILER_RING_SIZE];
+  }
+  return num_copied;
+}
+
+#endif
@@ -0,0 +1,88 @@
+/**
+ * Profiler - Times named scopes and counts engine work to see where a frame's time goes.
+ *
+ * Scopes are timed with time_ms() and kept in a fixed ring buffer, counters track PNG decodes,
+ * resource bytes read, bitmaps created and destroyed, and tiles and sprites drawn. Once per second
+ * a summary of the scopes and counters is written to the app log.
+ *
+ * Everything compiles out unless PGE_PROFILER is defined (e.g. with -DPGE_PROFILER in the build
+ * flags): the PGE_PROFILER_* macros then expand to nothing and no profiler state is allocated.
+ */
+#pragma once
+
+#include <pebble.h>
+
+// Number of scope samples kept, older samples are overwritten
+#ifndef PGE_PROFILER_RING_SIZE
+#define PGE_PROFILER_RING_SIZE 64
+#endif
+
+// Maximum number of distinct scopes in a per-second summary
+#ifndef PGE_PROFILER_MAX_SCOPES
+#define PGE_PROFILER_MAX_SCOPES 8
+#endif
+
+typedef enum {
+  PGEProfilerCounterPNGDecodes = 0,
+  PGEProfilerCounterResourceBytes,
+  PGEProfilerCounterBitmapsCreated,
+  PGEProfilerCounterBitmapsDestroyed,
+  PGEProfilerCounterTilesDrawn,
+  PGEProfilerCounterSpritesDrawn,
+  PGEProfilerCounterCount
+} PGEProfilerCounter;
+
+typedef struct {
+  const char *name;       // Scope name, a string literal
+  uint32_t start_ms;      // Start of the scope, in milliseconds since the profiler started
+  uint16_t duration_ms;
+} PGEProfilerSample;
+
+#ifdef PGE_PROFILER
+
+// Time the code between PGE_PROFILER_BEGIN(scope) and PGE_PROFILER_END(scope) in the same block
+#define PGE_PROFILER_BEGIN(scope) uint64_t pge_profiler_start_##scope = pge_profiler_now_ms()
+#define PGE_PROFILER_END(scope) pge_profiler_record(#scope, pge_profiler_start_##scope)
+#define PGE_PROFILER_COUNT(counter, amount) pge_profiler_count((counter), (amount))
+#define PGE_PROFILER_UPDATE() pge_profiler_update()
+
+/**
+ * Get the current time in milliseconds
+ */
+uint64_t pge_profiler_now_ms();
+
+/**
+ * Add a sample for a scope that started at start_ms (from pge_profiler_now_ms()) and ends now
+ */
+void pge_profiler_record(const char *name, uint64_t start_ms);
+
+/**
+ * Add amount to a counter
+ */
+void pge_profiler_count(PGEProfilerCounter counter, uint32_t amount);
+
+/**
+ * Log the summary of the last second once a second has passed since the previous one.
+ * Called by the engine every frame.
+ */
+void pge_profiler_update();
+
+/**
+ * Get the value of a counter over the last summarized second
+ */
+uint32_t pge_profiler_get_counter(PGEProfilerCounter counter);
+
+/**
+ * Copy up to max_samples of the most recent samples, newest first.
+ * Returns the number of samples copied.
+ */
+uint32_t pge_profiler_get_samples(PGEProfilerSample *samples, uint32_t max_samples);
+
+#else
+
+#define PGE_PROFILER_BEGIN(scope)
+#define PGE_PROFILER_END(scope)
+#define PGE_PROFILER_COUNT(counter, amount)
+#define PGE_PROFILER_UPDATE()
+
+#endif
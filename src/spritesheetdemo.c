@@ -2,6 +2,8 @@
 #include "pge/pge.h"
 #include "pge/additional/pge_spritesheet.h"
 #include "pge/additional/pge_tilesheet.h"
+#include "pge/additional/pge_tilelayers.h"
+#include "../resources/images/mariospritesheet_tilesets.h"
 
 #define NUM_MARIO_SPRITESETS 6
 #define INDEX_BIG_MARIO      0
@@ -14,7 +16,6 @@
 Window *s_window;
 PGESpriteSheet *s_spritesheet;
 uint32_t s_mario_spritesets[NUM_MARIO_SPRITESETS];
-uint32_t s_num_sprites[NUM_MARIO_SPRITESETS];
 bool auto_increment = false;
 PGESprite* mario_large;
 PGESprite* luigi_large;
@@ -23,7 +24,9 @@ PGESpriteTableHandle sth;
 uint32_t mario_index = 0;
 bool anim_forward = true;
 
-char tileset_name[20];
+PGETilesetHandle mario_tileset;
+PGETilesetHandle luigi_tileset;
+PGETilesetHandle current_tileset;
 
 PGESprite* bush1;
 PGESprite* bush2;
@@ -32,28 +35,10 @@ PGESprite* cloud;
 
 PGETileSheetHandle s_tilesheet_handle;
 GSize s_tilesheet_size;
+PGETileLayerStack *s_tilelayers;
 
-// Increment or decrement the sprite_index for a given PGESpriteSet pointed to by set_index.
-// Wrap around if reached 0 or the number of sprites in a set.
-static void update_index(bool increment, uint32_t set_index) {
-  uint32_t sprite_index = pge_spritesheet_get_sprite_index(s_spritesheet, set_index);
-  if (increment) {
-    if (sprite_index + 1 >= s_num_sprites[set_index]) {
-      pge_spritesheet_set_sprite_index(s_spritesheet, set_index, 0);
-    } else {
-      pge_spritesheet_set_sprite_index(s_spritesheet, set_index, sprite_index + 1);
-    }
-  } else {
-    if (sprite_index ==  0) {
-      pge_spritesheet_set_sprite_index(s_spritesheet, set_index, s_num_sprites[set_index] - 1);
-    } else {
-      pge_spritesheet_set_sprite_index(s_spritesheet, set_index, sprite_index - 1);
-    }
-  }
-}
-
-static int16_t ground_position = 16;
 #define GROUND_HEIGHT (168 - 32)
+#define FRAMERATE 20
 
 typedef enum {
   JUMP_STATE_NONE,
@@ -65,29 +50,43 @@ typedef enum {
 static JumpState jump_state = JUMP_STATE_NONE;
 #define INITIAL_MARIO_POSITION (GPoint(40, GROUND_HEIGHT - 32))
 static GPoint mario_position = {40, GROUND_HEIGHT - 32};
-static GPoint bush_position;
-static GPoint cloud_position;
+static GPoint bush_position;   // World position
+static GPoint cloud_position;  // World position
 static uint32_t top_count = 0;
+static uint32_t s_tile_anim_clock_ms = 0;
+static uint32_t s_tile_anim_serial = 0;
 
-void logic() {
+// Mario in the coordinates of the ground tile sheet, drawn at GROUND_HEIGHT and scrolled by the camera
+static GRect mario_ground_rect() {
+  return GRect(mario_position.x + (pge_camera_get_position().x % 16), mario_position.y - GROUND_HEIGHT, 16, 32);
 }
 
-//bush - 11, 8 and 12, 8
+void logic() {
+  uint32_t previous_mario_index = mario_index;
+
+  // Animated tiles follow the logic ticks rather than the governed framerate, so a replay draws the same frames
+  s_tile_anim_clock_ms += 1000 / FRAMERATE;
+  pge_tilesheet_set_anim_clock(s_tile_anim_clock_ms);
+  uint32_t previous_tile_anim_serial = s_tile_anim_serial;
+  s_tile_anim_serial = pge_tilesheet_update_animations(s_tilesheet_handle);
 
-void draw(GContext *ctx) {
   if (auto_increment) {
-    ground_position -= 4;
-    if (ground_position == 0) {
-      ground_position = 16;
+    // The world scrolls by moving the camera, scenery that left the screen comes back on the right
+    pge_camera_move(4, 0);
+    GPoint camera = pge_camera_get_position();
+    if (bush_position.x - camera.x == -40) {
+      bush_position.x += 184;
     }
-    bush_position.x -= 4;
-    if (bush_position.x == -40) {
-      bush_position.x = 144;
+
+    if (cloud_position.x - camera.x == -96) {
+      cloud_position.x += 240;
     }
 
-    cloud_position.x -= 4;
-    if (cloud_position.x == -96) {
-      cloud_position.x = 144;
+    // Keep world coordinates small, a multiple of the ground tile size keeps the ground aligned
+    if (camera.x >= 1024) {
+      pge_camera_move(-1024, 0);
+      bush_position.x -= 1024;
+      cloud_position.x -= 1024;
     }
   }
 
@@ -120,15 +119,25 @@ void draw(GContext *ctx) {
       jump_state = JUMP_STATE_DOWN;
     }
   } else if (jump_state == JUMP_STATE_DOWN) {
-    mario_position.y += 4;
-    if (mario_position.y == INITIAL_MARIO_POSITION.y) {
+    // Fall until Mario stands on the solid ground tiles
+    mario_position.y += pge_tilesheet_sweep_y(s_tilesheet_handle, mario_ground_rect(), GSize(16, 16), 4);
+    if (pge_tilesheet_sweep_y(s_tilesheet_handle, mario_ground_rect(), GSize(16, 16), 1) == 0) {
       jump_state = JUMP_STATE_NONE;
       mario_index = 3;
       anim_forward = true;
     }
   }
 
+  // Only redraw when something moved or an animated tile changed frame
+  if (auto_increment || (jump_state != JUMP_STATE_NONE) || (mario_index != previous_mario_index) ||
+      (s_tile_anim_serial != previous_tile_anim_serial)) {
+    pge_mark_dirty();
+  }
+}
+
+//bush - 11, 8 and 12, 8
 
+void draw(GContext *ctx) {
 #ifdef PBL_PLATFORM_BASALT
   graphics_context_set_fill_color(ctx, GColorVividCerulean);
   graphics_fill_rect(ctx, GRect(0, 0, 144, 168), 0, GCornerNone);
@@ -158,42 +167,127 @@ void draw(GContext *ctx) {
   pge_sprite_set_position(cloud, draw_cloud_position);
   pge_sprite_draw(cloud, ctx);
 
-  if (current_sprite == mario_large) {
-    pge_sprite_set_position(mario_large, mario_position);
-    pge_spritesheet_set_anim_frame(mario_large, sth, "mario_large", mario_index);
-  } else {
-    pge_sprite_set_position(luigi_large, mario_position);
-    pge_spritesheet_set_anim_frame(luigi_large, sth, "luigi_large", mario_index);
-  }
+  // Mario stays at the same place on screen
+  pge_sprite_set_position(current_sprite, pge_camera_screen_to_world(mario_position));
+  pge_spritesheet_set_anim_frame_tileset(current_sprite, sth, current_tileset, mario_index);
   pge_sprite_draw(current_sprite, ctx);
 
-  pge_tilesheet_draw_grid(ctx, s_tilesheet_handle, GRect(0, 0, s_tilesheet_size.w, s_tilesheet_size.h),
-                          GPoint((ground_position - 16), GROUND_HEIGHT), GSize(16, 16));
+  // Only the columns scrolled into view are redrawn
+  pge_tilelayers_set_camera(s_tilelayers, GPoint(pge_camera_get_position().x % 16, 0));
+  pge_tilelayers_draw(ctx, s_tilelayers);
 }
 
 // Optional, can be NULL if only using pge_get_button_state()
+// Long press select to start recording the input, again to stop and replay it as a benchmark
+static uint8_t s_input_log[1024];
+
+// Game state when the recording started, the replay starts from it again and must end on the state the
+// recording stopped at
+typedef struct {
+  GPoint mario_position;
+  GPoint bush_position;
+  GPoint cloud_position;
+  GPoint camera_position;
+  JumpState jump_state;
+  uint32_t top_count;
+  uint32_t mario_index;
+  bool anim_forward;
+  bool auto_increment;
+  PGESprite *current_sprite;
+  PGETilesetHandle current_tileset;
+  uint32_t tile_anim_clock_ms;
+} GameState;
+
+static GameState s_record_start_state;
+static GameState s_record_stop_state;
+
+static void save_state(GameState *state) {
+  // Cleared first so that states compare with memcmp, padding included
+  memset(state, 0, sizeof(GameState));
+  state->mario_position = mario_position;
+  state->bush_position = bush_position;
+  state->cloud_position = cloud_position;
+  state->camera_position = pge_camera_get_position();
+  state->jump_state = jump_state;
+  state->top_count = top_count;
+  state->mario_index = mario_index;
+  state->anim_forward = anim_forward;
+  state->auto_increment = auto_increment;
+  state->current_sprite = current_sprite;
+  state->current_tileset = current_tileset;
+  state->tile_anim_clock_ms = s_tile_anim_clock_ms;
+}
+
+static void restore_state(const GameState *state) {
+  mario_position = state->mario_position;
+  bush_position = state->bush_position;
+  cloud_position = state->cloud_position;
+  pge_camera_set_position(state->camera_position);
+  jump_state = state->jump_state;
+  top_count = state->top_count;
+  mario_index = state->mario_index;
+  anim_forward = state->anim_forward;
+  auto_increment = state->auto_increment;
+  current_sprite = state->current_sprite;
+  current_tileset = state->current_tileset;
+  s_tile_anim_clock_ms = state->tile_anim_clock_ms;
+  pge_tilesheet_set_anim_clock(s_tile_anim_clock_ms);
+}
+
+static void benchmark_finished(uint32_t num_ticks, uint32_t elapsed_ms) {
+  APP_LOG(APP_LOG_LEVEL_INFO, "Replayed %ld ticks in %ld ms", num_ticks, elapsed_ms);
+
+  GameState state;
+  save_state(&state);
+  if (memcmp(&state, &s_record_stop_state, sizeof(GameState)) == 0) {
+    APP_LOG(APP_LOG_LEVEL_INFO, "Replay ended on the recorded state");
+  } else {
+    APP_LOG(APP_LOG_LEVEL_WARNING, "Replay diverged from the recording");
+  }
+}
+
+static void toggle_benchmark() {
+  if (pge_is_recording()) {
+    size_t size = pge_record_stop();
+    save_state(&s_record_stop_state);
+    restore_state(&s_record_start_state);
+    pge_replay_start(s_input_log, size, benchmark_finished);
+  } else if (!pge_is_replaying()) {
+    save_state(&s_record_start_state);
+    pge_record_start(s_input_log, sizeof(s_input_log));
+  }
+}
+
 void click(int button_id, bool long_click) {
-  if ((button_id == BUTTON_ID_UP) && (jump_state == JUMP_STATE_NONE)) {
+  if ((button_id == BUTTON_ID_SELECT) && long_click) {
+    toggle_benchmark();
+  } else if ((button_id == BUTTON_ID_UP) && (jump_state == JUMP_STATE_NONE)) {
     mario_index = 15;
     jump_state = JUMP_STATE_UP;
     anim_forward = false;
   } else if (button_id == BUTTON_ID_DOWN) {
     if (current_sprite == mario_large) {
       current_sprite = luigi_large;
-      strncpy(tileset_name, "luigi_large", sizeof(tileset_name));
+      current_tileset = luigi_tileset;
     } else {
       current_sprite = mario_large;
-      strncpy(tileset_name, "mario_large", sizeof(tileset_name));
+      current_tileset = mario_tileset;
     }
   } else if (button_id == BUTTON_ID_SELECT) {
     auto_increment = !auto_increment;
   }
+  pge_mark_dirty();
 }
 
 void pge_init() {
   APP_LOG(APP_LOG_LEVEL_DEBUG, "Begin game");
   s_window = pge_begin(GColorBlack, logic, draw, click);
-  pge_set_framerate(20);
+  pge_set_framerate(FRAMERATE);
+  pge_set_render_mode(PGERenderModeOnChange);
+
+  // Slow down after a second of standing still, a button press brings back the full framerate
+  pge_governor_set_enabled(true, 20);
+  pge_governor_set_min_framerate(2);
   s_spritesheet = pge_spritesheet_create(RESOURCE_ID_MARIOSPRITESHEET, NUM_MARIO_SPRITESETS);
 
   if (s_spritesheet) {
@@ -207,27 +301,44 @@ void pge_init() {
   if (!s_tilesheet_handle) {
     APP_LOG(APP_LOG_LEVEL_ERROR, "ERROR: Unable to create tilesheet");
   }
+  mario_tileset = MARIOSPRITESHEET_TILESET_MARIO_LARGE;
+  luigi_tileset = MARIOSPRITESHEET_TILESET_LUIGI_LARGE;
   mario_index = 2;
-  mario_large = pge_spritesheet_create_sprite(sth, "mario_large", mario_index, INITIAL_MARIO_POSITION);
-  luigi_large = pge_spritesheet_create_sprite(sth, "luigi_large", mario_index, INITIAL_MARIO_POSITION);
+  mario_large = pge_spritesheet_create_sprite_tileset(sth, mario_tileset, mario_index, INITIAL_MARIO_POSITION);
+  luigi_large = pge_spritesheet_create_sprite_tileset(sth, luigi_tileset, mario_index, INITIAL_MARIO_POSITION);
   anim_forward = true;
   current_sprite = mario_large;
+  current_tileset = mario_tileset;
 
   bush_position = GPoint(80, INITIAL_MARIO_POSITION.y + 16);
-  bush1 = pge_spritesheet_create_sprite(sth, "mariotiles", 9*33 + 14 - 2, bush_position);
+  bush1 = pge_spritesheet_create_sprite_gid(sth, MARIOSPRITESHEET_MARIOTILES_BUSH_LEFT_GID, bush_position);
   bush_position.x += 16;
-  bush2 = pge_spritesheet_create_sprite(sth, "mariotiles", 9*33 + 14 - 1, bush_position);
+  bush2 = pge_spritesheet_create_sprite_gid(sth, MARIOSPRITESHEET_MARIOTILES_BUSH_MIDDLE_GID, bush_position);
   bush_position.x += 16;
-  bush3 = pge_spritesheet_create_sprite(sth, "mariotiles", 9*33 + 14, bush_position);
+  bush3 = pge_spritesheet_create_sprite_gid(sth, MARIOSPRITESHEET_MARIOTILES_BUSH_RIGHT_GID, bush_position);
 
   cloud_position = GPoint(20, 10);
-  cloud = pge_spritesheet_create_sprite(sth, "cloud", 1, cloud_position);
+  cloud = pge_spritesheet_create_sprite_gid(sth, MARIOSPRITESHEET_CLOUD_CLOUD_GID, cloud_position);
 
   s_tilesheet_size = pge_tilesheet_get_tilesheet_size(s_tilesheet_handle);
+  s_tilelayers = pge_tilelayers_create(1, GRect(0, 0, 144, 168));
+  pge_tilelayers_add_layer(s_tilelayers, s_tilesheet_handle, GRect(0, GROUND_HEIGHT, 144, 32), GSize(16, 16),
+                           PGE_TILELAYER_PARALLAX_ONE);
 }
 
 void pge_deinit() {
   pge_spritesheet_destroy(s_spritesheet);
+  pge_tilelayers_destroy(s_tilelayers);
+  pge_tilesheet_destroy(s_tilesheet_handle);
+
+  // Sprites and the tile sheet borrow bitmaps of the table, release them before unloading it
+  pge_sprite_destroy(mario_large);
+  pge_sprite_destroy(luigi_large);
+  pge_sprite_destroy(bush1);
+  pge_sprite_destroy(bush2);
+  pge_sprite_destroy(bush3);
+  pge_sprite_destroy(cloud);
+  pge_spritesheet_unload_table(sth);
 
   // Destroy all game resources
   pge_finish();